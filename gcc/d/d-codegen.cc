@@ -32,6 +32,7 @@
 #include "tree-iterator.h"
 #include "fold-const.h"
 #include "diagnostic.h"
+#include "tm.h"
 #include "langhooks.h"
 #include "target.h"
 #include "stringpool.h"
@@ -1555,6 +1556,141 @@ build_vindex_ref(tree object, tree fntype, size_t index)
   return build_memref(fntype, result, size_int(Target::ptrsize * index));
 }
 
+// Returns the classes that can be instantiated and have CD as a base
+// class, or are CD.  Only complete if the whole program is compiled.
+
+static vec<ClassDeclaration *> *
+derived_classes(ClassDeclaration *cd)
+{
+  static hash_map<ClassDeclaration *, vec<ClassDeclaration *> > *cache;
+
+  if (cache == NULL)
+    cache = new hash_map<ClassDeclaration *, vec<ClassDeclaration *> >;
+
+  bool existed;
+  vec<ClassDeclaration *> &classes = cache->get_or_insert(cd, &existed);
+  if (existed)
+    return &classes;
+
+  classes = vNULL;
+  for (size_t i = 0; i < ClassDeclaration::allClasses.dim; i++)
+    {
+      ClassDeclaration *c = ClassDeclaration::allClasses[i];
+      if (c->isAbstract() || (c != cd && !cd->isBaseOf(c, NULL)))
+	continue;
+      if (!classes.contains(c))
+	classes.safe_push(c);
+    }
+
+  return &classes;
+}
+
+// Returns the function always called by a virtual call to FD on an object
+// whose static type is TYPE, or NULL if that isn't known.  If *LIKELY is
+// set, it is the function called for most classes, to try first.
+
+FuncDeclaration *
+devirtualize_call(FuncDeclaration *fd, Type *type, FuncDeclaration **likely)
+{
+  if (likely)
+    *likely = NULL;
+
+  Type *tb = type->toBasetype();
+  if (tb->ty != Tclass)
+    return NULL;
+
+  ClassDeclaration *cd = ((TypeClass *) tb)->sym;
+  if (cd->isInterfaceDeclaration() || cd->isCPPclass() || cd->isCOMclass()
+      || !fd->toParent()->isClassDeclaration()
+      || fd->toParent()->isInterfaceDeclaration())
+    return NULL;
+
+  // No derived class can override the function of a final class.
+  if (cd->storage_class & STCfinal)
+    return fd;
+
+  // Otherwise, all the classes deriving from CD have to be known, which
+  // is only the case for classes of the modules being compiled.
+  if (!flag_whole_program || !cd->getModule() || !cd->getModule()->isRoot())
+    return NULL;
+
+  // Find the functions in the vtable slot of FD of all derived classes.
+  vec<ClassDeclaration *> *classes = derived_classes(cd);
+  auto_vec<FuncDeclaration *> targets;
+  auto_vec<unsigned> counts;
+
+  for (size_t i = 0; i < classes->length(); i++)
+    {
+      ClassDeclaration *c = (*classes)[i];
+      if (fd->vtblIndex < 0 || (size_t) fd->vtblIndex >= c->vtbl.dim)
+	return NULL;
+
+      FuncDeclaration *f = c->vtbl[fd->vtblIndex]->isFuncDeclaration();
+      if (f == NULL)
+	return NULL;
+
+      size_t j;
+      for (j = 0; j < targets.length(); j++)
+	{
+	  if (targets[j] == f)
+	    break;
+	}
+
+      if (j == targets.length())
+	{
+	  targets.safe_push(f);
+	  counts.safe_push(0);
+	}
+      counts[j]++;
+    }
+
+  if (targets.length() == 1)
+    return targets[0];
+
+  // Speculate on the function called for more than half the classes.
+  if (likely && !optimize_size)
+    {
+      for (size_t j = 0; j < targets.length(); j++)
+	{
+	  if (counts[j] * 2 > classes->length())
+	    *likely = targets[j];
+	}
+    }
+
+  return NULL;
+}
+
+// Build a call to the function LIKELY if the virtual call EXP would call
+// it, otherwise do EXP.  Calling it directly lets it be inlined.
+
+tree
+build_speculative_call(tree exp, FuncDeclaration *likely)
+{
+  if (TREE_CODE (exp) != CALL_EXPR || AGGREGATE_TYPE_P (TREE_TYPE (exp)))
+    return exp;
+
+  // The condition evaluates the object and the callee, so only do this
+  // if the arguments can be evaluated in either branch.
+  for (int i = 1; i < call_expr_nargs (exp); i++)
+    {
+      tree arg = CALL_EXPR_ARG (exp, i);
+      STRIP_NOPS (arg);
+      if (!DECL_P (arg) && !CONSTANT_CLASS_P (arg))
+	return exp;
+    }
+
+  tree callee = save_expr(CALL_EXPR_FN (exp));
+  tree target = build_nop(TREE_TYPE (callee),
+			  build_address(likely->toSymbol()->Stree));
+
+  tree direct = copy_node(exp);
+  CALL_EXPR_FN (direct) = target;
+  CALL_EXPR_FN (exp) = callee;
+
+  tree cond = build_boolop(EQ_EXPR, callee, target);
+  return build_condition(TREE_TYPE (exp), cond, direct, exp);
+}
+
 // Builds a record type from field types T1 and T2.  TYPE is the D frontend
 // type we are building. N1 and N2 are the names of the two fields.
 
@@ -2196,7 +2332,10 @@ build_nop(tree type, tree exp)
 tree
 build_vconvert(tree type, tree exp)
 {
-  return indirect_ref(type, build_address(exp));
+  // The access won't agree with the alias set of EXP, so go through
+  // a pointer that may alias anything.
+  tree ptrtype = build_pointer_type_for_mode(type, ptr_mode, true);
+  return build_deref(build_nop(ptrtype, build_address(exp)));
 }
 
 // Build a boolean ARG0 op ARG1 expression.
@@ -2463,6 +2602,294 @@ build_array_set(tree ptr, tree length, tree value)
 		BLOCK_VARS (block), stmt_list, block);
 }
 
+// Returns TRUE if the runtime hashes associative array keys of type TKEY
+// to the value of the key itself.  Two such keys are equal exactly when
+// their hashes are, so they need not be compared.
+
+static bool
+aa_key_hashed_by_value_p(Type *tkey)
+{
+  switch (tkey->toBasetype()->ty)
+    {
+    case Tint8:
+    case Tuns8:
+    case Tint16:
+    case Tuns16:
+    case Tint32:
+    case Tuns32:
+    case Tchar:
+    case Twchar:
+    case Tdchar:
+    case Tbool:
+    case Tpointer:
+      return true;
+
+    default:
+      return false;
+    }
+}
+
+// Returns TRUE if TKEY is an array of chars, which TypeInfo_Aa hashes
+// and compares.  Only the TypeInfo of these arrays is in the runtime.
+
+static bool
+aa_string_key_p(Type *tkey)
+{
+  Type *tb = tkey->toBasetype();
+  if (tb->ty != Tarray || tb->mod)
+    return false;
+
+  Type *next = tb->nextOf();
+  return next->ty == Tchar
+    && (!next->mod || next->mod == MODconst || next->mod == MODimmutable);
+}
+
+// Returns TRUE if associative array lookups of keys of type TKEY can be
+// done inline, because the hash the runtime computes for them is known.
+
+bool
+aa_inline_key_p(Type *tkey)
+{
+  if (aa_key_hashed_by_value_p(tkey) || aa_string_key_p(tkey))
+    return true;
+
+  Type *tb = tkey->toBasetype();
+  return tb->ty == Tint64 || tb->ty == Tuns64;
+}
+
+// Returns the 16 bits at byte offset N in memory of the 64-bit value V,
+// read as get16bits does in rt.util.hash.
+
+static tree
+aa_hash_get16bits(tree v, int n)
+{
+  tree bytes[2];
+
+  for (int i = 0; i < 2; i++)
+    {
+      int shift = BYTES_BIG_ENDIAN ? 8 * (7 - n - i) : 8 * (n + i);
+      tree t = fold_build2(RSHIFT_EXPR, TREE_TYPE (v), v,
+			   build_int_cst(integer_type_node, shift));
+      t = fold_build2(BIT_AND_EXPR, TREE_TYPE (v), t,
+		      build_int_cst(TREE_TYPE (v), 0xff));
+      bytes[i] = d_convert(size_type_node, t);
+    }
+
+  tree t = fold_build2(LSHIFT_EXPR, size_type_node, bytes[1],
+		       build_int_cst(integer_type_node, 8));
+  return fold_build2(BIT_IOR_EXPR, size_type_node, bytes[0], t);
+}
+
+// Add the statement HASH = HASH CODE (HASH SHIFT BITS).
+
+static void
+aa_hash_mix(tree hash, tree_code code, tree_code shift, int bits)
+{
+  tree t = build2(shift, size_type_node, hash,
+		  build_int_cst(integer_type_node, bits));
+  add_stmt(vmodify_expr(hash, build2(code, size_type_node, hash, t)));
+}
+
+// Returns the hash the runtime computes for KEY of type TKEY, which must
+// satisfy aa_inline_key_p.  KEY must be a local variable.  Statements
+// computing the hash may be added to the current statement list.
+
+static tree
+build_aa_hash(tree key, Type *tkey)
+{
+  Type *tb = tkey->toBasetype();
+
+  if (aa_string_key_p(tb))
+    {
+      // TypeInfo_Aa.getHash:
+      //	foreach (char c; s)
+      //	  hash = hash * 11 + c;
+      tree hash = build_local_temp(size_type_node);
+      tree index = build_local_temp(size_type_node);
+      tree length = d_convert(size_type_node, d_array_length(key));
+      add_stmt(build_vinit(hash, size_zero_node));
+      add_stmt(build_vinit(index, size_zero_node));
+
+      push_stmt_list();
+      tree t = build_boolop(EQ_EXPR, index, length);
+      add_stmt(build1(EXIT_EXPR, void_type_node, t));
+
+      t = build_deref(build_array_index(d_array_ptr(key), index));
+      t = d_convert(size_type_node, d_convert(build_ctype(Type::tuns8), t));
+      t = build2(PLUS_EXPR, size_type_node,
+		 build2(MULT_EXPR, size_type_node, hash, size_int(11)), t);
+      add_stmt(vmodify_expr(hash, t));
+      add_stmt(vmodify_expr(index, build2(PLUS_EXPR, size_type_node,
+					  index, size_one_node)));
+
+      tree body = pop_stmt_list();
+      add_stmt(build1(LOOP_EXPR, void_type_node, body));
+      return hash;
+    }
+
+  if (tb->ty == Tint64 || tb->ty == Tuns64)
+    {
+      // rt.util.hash.hashOf(&key, 8), with the loop over the four 16-bit
+      // words unrolled, and no remainder.
+      tree v = d_convert(build_ctype(Type::tuns64), key);
+      tree hash = build_local_temp(size_type_node);
+      add_stmt(build_vinit(hash, size_zero_node));
+
+      for (int n = 0; n < 8; n += 4)
+	{
+	  //	hash += get16bits(data);
+	  //	tmp = (get16bits(data + 2) << 11) ^ hash;
+	  //	hash = (hash << 16) ^ tmp;
+	  //	hash += hash >> 11;
+	  tree t = build2(PLUS_EXPR, size_type_node, hash,
+			  aa_hash_get16bits(v, n));
+	  add_stmt(vmodify_expr(hash, t));
+
+	  t = build2(LSHIFT_EXPR, size_type_node, aa_hash_get16bits(v, n + 2),
+		     build_int_cst(integer_type_node, 11));
+	  t = build2(BIT_XOR_EXPR, size_type_node, t, hash);
+	  t = build2(BIT_XOR_EXPR, size_type_node,
+		     build2(LSHIFT_EXPR, size_type_node, hash,
+			    build_int_cst(integer_type_node, 16)), t);
+	  add_stmt(vmodify_expr(hash, t));
+	  aa_hash_mix(hash, PLUS_EXPR, RSHIFT_EXPR, 11);
+	}
+
+      // Force "avalanching" of final 127 bits.
+      aa_hash_mix(hash, BIT_XOR_EXPR, LSHIFT_EXPR, 3);
+      aa_hash_mix(hash, PLUS_EXPR, RSHIFT_EXPR, 5);
+      aa_hash_mix(hash, BIT_XOR_EXPR, LSHIFT_EXPR, 4);
+      aa_hash_mix(hash, PLUS_EXPR, RSHIFT_EXPR, 17);
+      aa_hash_mix(hash, BIT_XOR_EXPR, LSHIFT_EXPR, 25);
+      aa_hash_mix(hash, PLUS_EXPR, RSHIFT_EXPR, 6);
+      return hash;
+    }
+
+  // The TypeInfo for int hashes it as a uint.
+  if (tb->ty == Tint32)
+    key = d_convert(build_ctype(Type::tuns32), key);
+
+  return d_convert(size_type_node, key);
+}
+
+// Returns the condition that the key stored in the associative array entry
+// ENTRY equals KEY of type TKEY, as the TypeInfo of TKEY compares them.
+
+static tree
+build_aa_key_equal(tree entry, tree key, Type *tkey)
+{
+  // The key follows the next and hash fields of Entry.
+  tree ekey = indirect_ref(TREE_TYPE (key),
+			   build_offset(entry, size_int(2 * Target::ptrsize)));
+
+  if (aa_string_key_p(tkey))
+    {
+      // s1.length == s2.length && memcmp(s1.ptr, s2.ptr, s1.length) == 0
+      tree length = d_array_length(key);
+      tree t = d_build_call_nary(builtin_decl_explicit(BUILT_IN_MEMCMP), 3,
+				 d_array_ptr(ekey), d_array_ptr(key), length);
+      t = build_boolop(EQ_EXPR, t, integer_zero_node);
+      return build_boolop(TRUTH_ANDIF_EXPR,
+			  build_boolop(EQ_EXPR, d_array_length(ekey), length), t);
+    }
+
+  return build_boolop(EQ_EXPR, ekey, key);
+}
+
+// Build an inline lookup of KEY in the associative array AA, whose keys are
+// of type TKEY.  Returns a pointer to the value, or null if the key is not
+// in AA.  This depends on the layout of Impl and Entry in rt/aaA.d, and on
+// the hash functions of the TypeInfo for TKEY in the runtime.
+
+tree
+build_aa_lookup(tree aa, tree key, Type *tkey)
+{
+  tree ptrsize = size_int(Target::ptrsize);
+
+  // Offset of the value in an Entry, see aligntsize in rt/aaA.d.
+  dinteger_t align = global.params.isLP64 ? 16 : Target::ptrsize;
+  dinteger_t keysize = (tkey->size() + align - 1) & ~(align - 1);
+  tree valueoff = size_int(2 * Target::ptrsize + keysize);
+
+  // Build temporary for the entry found.
+  tree entry = build_local_temp(ptr_type_node);
+
+  push_binding_level(level_block);
+  push_stmt_list();
+
+  add_stmt(build_vinit(entry, null_pointer_node));
+
+  // Build temporary locals for the key, its hash, and the AA implementation.
+  tree t;
+  if (!DECL_P (key))
+    {
+      t = build_local_temp(TREE_TYPE (key));
+      add_stmt(build_vinit(t, key));
+      key = t;
+    }
+
+  t = build_local_temp(size_type_node);
+  add_stmt(build_vinit(t, build_aa_hash(key, tkey)));
+  tree hash = t;
+
+  t = build_local_temp(ptr_type_node);
+  aa = component_ref(aa, TYPE_FIELDS (TREE_TYPE (aa)));
+  add_stmt(build_vinit(t, d_convert(ptr_type_node, aa)));
+  tree impl = t;
+
+  // Find the bucket for the hash.
+  //	if (impl != null && impl.buckets.length != 0)
+  //	  entry = impl.buckets[hash % impl.buckets.length];
+  tree length = indirect_ref(size_type_node, impl);
+  tree buckets = indirect_ref(build_pointer_type(ptr_type_node),
+			      build_offset(impl, ptrsize));
+  tree index = fold_build2(TRUNC_MOD_EXPR, size_type_node, hash, length);
+
+  t = build_boolop(TRUTH_ANDIF_EXPR,
+		   build_boolop(NE_EXPR, impl, null_pointer_node),
+		   build_boolop(NE_EXPR, length, size_zero_node));
+  tree bucket = build_deref(build_array_index(buckets, index));
+  t = build_vcondition(t, vmodify_expr(entry, bucket), void_node);
+  add_stmt(t);
+
+  // Build loop for walking the bucket chain.
+  push_stmt_list();
+
+  // Exit logic for the loop.
+  //	if (entry == null || (entry.hash == hash && entry.key == key)) break
+  t = indirect_ref(size_type_node, build_offset(entry, ptrsize));
+  t = build_boolop(EQ_EXPR, t, hash);
+  if (!aa_key_hashed_by_value_p(tkey))
+    t = build_boolop(TRUTH_ANDIF_EXPR, t, build_aa_key_equal(entry, key, tkey));
+  t = build_boolop(TRUTH_ORIF_EXPR,
+		   build_boolop(EQ_EXPR, entry, null_pointer_node), t);
+  t = build1(EXIT_EXPR, void_type_node, t);
+  add_stmt(t);
+
+  // Move to the next entry.
+  //	entry = entry.next
+  t = vmodify_expr(entry, indirect_ref(ptr_type_node, entry));
+  add_stmt(t);
+
+  // Pop statements and finish loop.
+  tree body = pop_stmt_list();
+  add_stmt(build1(LOOP_EXPR, void_type_node, body));
+
+  // Wrap it up into a bind expression.
+  tree stmt_list = pop_stmt_list();
+  tree block = pop_binding_level();
+
+  body = build3(BIND_EXPR, void_type_node,
+		BLOCK_VARS (block), stmt_list, block);
+
+  // Return the address of the value, if found.
+  t = build_boolop(NE_EXPR, entry, null_pointer_node);
+  t = build_condition(ptr_type_node, t, build_offset(entry, valueoff),
+		      null_pointer_node);
+
+  return compound_expr(body, t);
+}
+
 // Implicitly converts void* T to byte* as D allows { void[] a; &a[3]; }
 
 tree
@@ -2576,6 +3003,12 @@ build_binop_assignment(tree_code code, Expression *e1, Expression *e2)
   return expr;
 }
 
+// Number of array bounds checks emitted, and left out because the index
+// was known to be in bounds, for -fbounds-check-report.
+
+unsigned bounds_checks_emitted;
+unsigned bounds_checks_removed;
+
 // Builds a bounds condition checking that INDEX is between 0 and LEN.
 // The condition returns the INDEX if true, or throws a RangeError.
 // If INCLUSIVE, we allow INDEX == LEN to return true also.
@@ -2586,6 +3019,8 @@ build_bounds_condition(const Loc& loc, tree index, tree len, bool inclusive)
   if (!array_bounds_check())
     return index;
 
+  bounds_checks_emitted++;
+
   // Prevent multiple evaluations of the index.
   index = maybe_make_temp(index);
 
@@ -2599,6 +3034,26 @@ build_bounds_condition(const Loc& loc, tree index, tree len, bool inclusive)
   return build_condition(TREE_TYPE (index), condition, boundserr, index);
 }
 
+// Returns TRUE if INDEX is the index of a foreach loop over the length of
+// the local array ARRAY, which the front end found is never changed in the
+// loop.  Only trusted in @safe code, where ARRAY can't be changed through
+// a pointer to it.
+
+bool
+index_in_bounds_p(Expression *array, Expression *index)
+{
+  if (array->op != TOKvar || index->op != TOKvar)
+    return false;
+
+  VarDeclaration *a = ((VarExp *) array)->var->isVarDeclaration();
+  VarDeclaration *v = ((VarExp *) index)->var->isVarDeclaration();
+  if (!a || !v || v->boundsArray != a)
+    return false;
+
+  FuncDeclaration *fd = a->toParent2()->isFuncDeclaration();
+  return fd && fd->isSafe();
+}
+
 // Returns TRUE if array bounds checking code generation is turned on.
 
 bool
@@ -2707,6 +3162,34 @@ call_by_alias_p (FuncDeclaration *caller, FuncDeclaration *callee)
   return true;
 }
 
+// Returns how the middle-end may treat calls to a function of type TF,
+// given the PURITY worked out by the front-end.  Returns ECF_PURE if the
+// result may only depend on the arguments and on memory that is not
+// written between calls, or zero otherwise.
+
+int
+d_purity_flags (TypeFunction *tf, PURE purity)
+{
+  if (purity < PUREconst)
+    return 0;
+
+  // Two calls that return a reference, or data with mutable indirections,
+  // can't be merged, as each may return fresh memory the caller writes to.
+  Type *tret = tf->nextOf();
+  if (tf->isref || tret == NULL)
+    return 0;
+
+  tret = tret->toBasetype();
+  if (tret->ty != Tvoid && tret->hasPointers()
+      && !tret->implicitConvTo(tret->immutableOf()))
+    return 0;
+
+  // Even strongly pure functions are never const, as they may read
+  // immutable module data, which is set in a shared static constructor.
+  // Stores that initialize it must not be moved or removed around the call.
+  return ECF_PURE;
+}
+
 // Entry point for call routines.  Builds a function call to FD.
 // OBJECT is the 'this' reference passed and ARGS are the arguments to FD.
 
@@ -2833,6 +3316,11 @@ d_build_call(TypeFunction *tf, tree callable, tree object, Expressions *argument
     }
 
   tree result = d_build_call_list(TREE_TYPE (ctype), callee, arg_list);
+
+  // No exception handling is needed around calls to nothrow functions.
+  if (tf->isnothrow)
+    TREE_NOTHROW (result) = 1;
+
   result = expand_intrinsic(result);
 
   return maybe_compound_expr(saved_args, result);
@@ -4106,6 +4594,7 @@ get_frameinfo(FuncDeclaration *fd)
     {
       ffi->creates_frame = true;
       ffi->is_closure = true;
+      fd->printClosureUsage();
     }
   else if (fd->closureVars.dim == 0)
     {
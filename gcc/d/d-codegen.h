@@ -131,6 +131,7 @@ extern tree build_memref (tree type, tree ptr, tree byte_offset);
 extern tree build_array_set(tree ptr, tree length, tree value);
 
 // Function calls
+extern int d_purity_flags (TypeFunction *tf, PURE purity);
 extern tree d_build_call (FuncDeclaration *fd, tree object, Expressions *args);
 extern tree d_build_call (TypeFunction *tf, tree callable, tree object, Expressions *arguments);
 extern tree d_build_call_list (tree type, tree callee, tree args);
@@ -166,7 +167,14 @@ extern bool d_has_side_effects (tree t);
 
 // Array operations
 extern tree build_bounds_condition(const Loc& loc, tree index, tree upr, bool inclusive);
+extern bool index_in_bounds_p(Expression *array, Expression *index);
 extern bool array_bounds_check();
+extern unsigned bounds_checks_emitted;
+extern unsigned bounds_checks_removed;
+
+// Associative arrays
+extern bool aa_inline_key_p(Type *tkey);
+extern tree build_aa_lookup(tree aa, tree key, Type *tkey);
 
 // Classes
 extern tree build_class_binfo (tree super, ClassDeclaration *cd);
@@ -181,6 +189,8 @@ extern tree build_delegate_cst (tree method, tree object, Type *type);
 extern tree build_method_call (tree callee, tree object, Type *type);
 extern void extract_from_method_call (tree t, tree& callee, tree& object);
 extern tree build_vindex_ref (tree object, tree fndecl, size_t index);
+extern FuncDeclaration *devirtualize_call(FuncDeclaration *fd, Type *type, FuncDeclaration **likely);
+extern tree build_speculative_call(tree exp, FuncDeclaration *likely);
 
 // Built-in and Library functions.
 extern FuncDeclaration *get_libcall (LibCall libcall);
@@ -413,6 +413,18 @@ FuncDeclaration::toSymbol()
       if (storage_class & STCfinal)
 	DECL_FINAL_P (fndecl) = 1;
 
+      // Purity and nothrow, whether declared or inferred.
+      if (type->ty == Tfunction)
+	{
+	  TypeFunction *tf = (TypeFunction *) type;
+
+	  if (tf->isnothrow && !(flags & FUNCFLAGnothrowInprocess))
+	    TREE_NOTHROW (fndecl) = 1;
+
+	  if (d_purity_flags(tf, isPureBypassingInference()) & ECF_PURE)
+	    DECL_PURE_P (fndecl) = 1;
+	}
+
 #if TARGET_DLLIMPORT_DECL_ATTRIBUTES
       // Have to test for import first
       if (isImportedSymbol())
@@ -251,6 +251,14 @@ InExp::toElem()
 
   Type *tkey = ((TypeAArray *) tb2)->index->toBasetype();
   tree key = convert_expr(e1->toElem(), e1->type, tkey);
+
+  // Look up keys whose hash is known inline.
+  if (aa_inline_key_p(tkey) && !optimize_size)
+    {
+      tree result = build_aa_lookup(e2->toElem(), key, tkey);
+      return build_nop(build_ctype(type), result);
+    }
+
   tree args[3];
 
   args[0] = e2->toElem();
@@ -1090,27 +1098,62 @@ IndexExp::toElem()
       // Get the key for the associative array.
       Type *tkey = ((TypeAArray *) tb1)->index->toBasetype();
       tree key = convert_expr(e2->toElem(), e2->type, tkey);
-      LibCall libcall;
+      tree ptrtype = build_ctype(type->pointerTo());
+      tree result;
       tree args[4];
 
-      if (modifiable)
+      if (aa_inline_key_p(tkey) && !optimize_size)
 	{
-	  libcall = LIBCALL_AAGETY;
-	  args[0] = build_address(e1->toElem());
-	  args[1] = build_typeinfo(tb1->unSharedOf()->mutableOf());
+	  // Look up keys whose hash is known inline, only calling the
+	  // runtime to insert a key that isn't found.
+	  if (modifiable)
+	    {
+	      tree aa = make_temp(build_address(e1->toElem()));
+	      tree var = build_local_temp(TREE_TYPE (key));
+	      tree init = build_vinit(var, key);
+
+	      result = make_temp(build_aa_lookup(build_deref(aa), var, tkey));
+
+	      args[0] = aa;
+	      args[1] = build_typeinfo(tb1->unSharedOf()->mutableOf());
+	      args[2] = size_int(tb1->nextOf()->size());
+	      args[3] = build_address(var);
+
+	      tree call = build_libcall(LIBCALL_AAGETY, 4, args, ptr_type_node);
+	      tree found = build_boolop(NE_EXPR, result, null_pointer_node);
+	      result = build_condition(ptr_type_node, found, result, call);
+	      result = compound_expr(init, result);
+	    }
+	  else
+	    {
+	      result = build_aa_lookup(e1->toElem(), key, tkey);
+	    }
+
+	  result = build_nop(ptrtype, result);
 	}
       else
 	{
-	  libcall = LIBCALL_AAGETRVALUEX;
-	  args[0] = e1->toElem();
-	  args[1] = build_typeinfo(tkey);
-	}
+	  LibCall libcall;
+
+	  if (modifiable)
+	    {
+	      libcall = LIBCALL_AAGETY;
+	      args[0] = build_address(e1->toElem());
+	      args[1] = build_typeinfo(tb1->unSharedOf()->mutableOf());
+	    }
+	  else
+	    {
+	      libcall = LIBCALL_AAGETRVALUEX;
+	      args[0] = e1->toElem();
+	      args[1] = build_typeinfo(tkey);
+	    }
 
-      args[2] = size_int(tb1->nextOf()->size());
-      args[3] = build_address(key);
+	  args[2] = size_int(tb1->nextOf()->size());
+	  args[3] = build_address(key);
 
-      // Index the associative array.
-      tree result = build_libcall(libcall, 4, args, build_ctype(type->pointerTo()));
+	  // Index the associative array.
+	  result = build_libcall(libcall, 4, args, ptrtype);
+	}
 
       if (!indexIsInBounds && array_bounds_check())
 	{
@@ -1143,10 +1186,15 @@ IndexExp::toElem()
       // Generate the index.
       tree index = e2->toElem();
 
-      // If it's a static array and the index is constant,
-      // the front end has already checked the bounds.
-      if (tb1->ty != Tpointer && !indexIsInBounds)
-	index = build_bounds_condition(e2->loc, index, length, false);
+      // If it's a static array and the index is constant, or it's the
+      // index of a foreach over the array, it is already in bounds.
+      if (tb1->ty != Tpointer)
+	{
+	  if (!indexIsInBounds && !index_in_bounds_p(e1, e2))
+	    index = build_bounds_condition(e2->loc, index, length, false);
+	  else if (array_bounds_check())
+	    bounds_checks_removed++;
+	}
 
       // Index the .ptr
       ptr = void_okay_p(ptr);
@@ -1253,7 +1301,7 @@ SliceExp::toElem()
   tree upr_tree = maybe_make_temp(upr->toElem());
   tree newlength;
 
-  if (!this->upperIsInBounds)
+  if (!this->upperIsInBounds && !index_in_bounds_p(e1, upr))
     {
       if (length)
 	newlength = build_bounds_condition(upr->loc, upr_tree, length, true);
@@ -1265,13 +1313,22 @@ SliceExp::toElem()
 	}
     }
   else
-    newlength = upr_tree;
+    {
+      if (length && array_bounds_check())
+	bounds_checks_removed++;
+      newlength = upr_tree;
+    }
 
   if (lwr_tree)
     {
       // Enforces lwr <= upr. No need to check lwr <= length as
-      // we've already ensured that upr <= length.
-      if (!this->lowerIsLessThanUpper)
+      // we've already ensured that upr <= length.  A foreach index
+      // is also less than a[i .. $].
+      bool lwr_in_bounds = (lengthVar && upr->op == TOKvar
+			    && ((VarExp *) upr)->var == lengthVar
+			    && index_in_bounds_p(e1, lwr));
+
+      if (!this->lowerIsLessThanUpper && !lwr_in_bounds)
 	{
 	  tree cond = build_bounds_condition(lwr->loc, lwr_tree, upr_tree, true);
 
@@ -1279,6 +1336,8 @@ SliceExp::toElem()
 	  if (cond != lwr_tree)
 	    newlength = compound_expr(cond, newlength);
 	}
+      else if (array_bounds_check())
+	bounds_checks_removed++;
 
       // Need to ensure lwr always gets evaluated first, as it may be a
       // function call.  Generates (lwr, upr) - lwr.
@@ -1518,6 +1577,7 @@ CallExp::toElem()
   tree callee = NULL_TREE;
   tree object = NULL_TREE;
   TypeFunction *tf = NULL;
+  FuncDeclaration *likely = NULL;
 
   // Calls to delegates can sometimes look like this:
   if (e1b->op == TOKcomma)
@@ -1577,11 +1637,17 @@ CallExp::toElem()
 	      if (dve->e1->type->ty != Tclass && dve->e1->type->ty != Tpointer)
 		thisexp = build_address(thisexp);
 
-	      // Make the callee a virtual call.
+	      // Make the callee a virtual call, unless the function called
+	      // is known from the type of the object.
 	      if (fd->isVirtual() && !fd->isFinalFunc() && !is_dottype)
 		{
 		  tree fntype = build_pointer_type(TREE_TYPE (fndecl));
-		  fndecl = build_vindex_ref(thisexp, fntype, fd->vtblIndex);
+		  FuncDeclaration *target = devirtualize_call(fd, dve->e1->type, &likely);
+
+		  if (target != NULL)
+		    fndecl = build_nop(fntype, build_address(target->toSymbol()->Stree));
+		  else
+		    fndecl = build_vindex_ref(thisexp, fntype, fd->vtblIndex);
 		}
 	      else
 		fndecl = build_address(fndecl);
@@ -1650,6 +1716,9 @@ CallExp::toElem()
   // build the call expression.
   tree exp = d_build_call (tf, callee, object, arguments);
 
+  if (likely != NULL)
+    exp = build_speculative_call (exp, likely);
+
   if (tf->isref)
     exp = build_deref(exp);
 
@@ -1788,10 +1857,19 @@ DelegateExp::toElem()
 
       fndecl = build_address(func->toSymbol()->Stree);
 
-      // Get pointer to function out of the virtual table.
+      // Get pointer to function out of the virtual table, unless the
+      // function is known from the type of the object.
       if (func->isVirtual() && !func->isFinalFunc()
 	  && e1->op != TOKsuper && e1->op != TOKdottype)
-	fndecl = build_vindex_ref(object, TREE_TYPE (fndecl), func->vtblIndex);
+	{
+	  FuncDeclaration *target = devirtualize_call(func, e1->type, NULL);
+
+	  if (target != NULL)
+	    fndecl = build_nop(TREE_TYPE (fndecl),
+			       build_address(target->toSymbol()->Stree));
+	  else
+	    fndecl = build_vindex_ref(object, TREE_TYPE (fndecl), func->vtblIndex);
+	}
     }
 
   return build_method_call(fndecl, object, type);
@@ -2416,22 +2494,53 @@ ArrayLiteralExp::toElem()
   if (tb->ty == Tsarray)
     return d_convert (build_ctype(type), ctor);
 
-  args[0] = build_typeinfo (etype->arrayOf());
-  args[1] = size_int(elements->dim);
+  tree ptrtype = build_ctype(etype->pointerTo());
 
-  // Call _d_arrayliteralTX (ti, dim);
-  tree mem = build_libcall (LIBCALL_ARRAYLITERALTX, 2, args, build_ctype(etype->pointerTo()));
-  mem = maybe_make_temp (mem);
+  if (etype->isImmutable() && initializer_constant_valid_p (ctor, tsa))
+    {
+      // Literals of immutable constants are put in read-only static data.
+      Symbol *sym = new Symbol();
+      tree decl = build_decl (UNKNOWN_LOCATION, VAR_DECL, NULL_TREE, tsa);
+      get_unique_name (decl);
 
-  // memcpy (mem, &ctor, size)
-  tree size = fold_build2 (MULT_EXPR, size_type_node,
-			   size_int (elements->dim), size_int (tb->nextOf()->size()));
+      DECL_INITIAL (decl) = ctor;
+      TREE_PUBLIC (decl) = 0;
+      TREE_USED (decl) = 1;
+      DECL_IGNORED_P (decl) = 1;
+      DECL_ARTIFICIAL (decl) = 1;
 
-  result = d_build_call_nary (builtin_decl_explicit (BUILT_IN_MEMCPY), 3,
-			      mem, build_address (ctor), size);
+      sym->Stree = decl;
+      sym->Sreadonly = true;
+      d_finish_symbol (sym);
 
-  // Returns array pointed to by MEM.
-  result = maybe_compound_expr (result, mem);
+      result = build_nop (ptrtype, build_address (decl));
+    }
+  else if (onstack)
+    {
+      // Literals that don't escape are put in a temporary on the stack.
+      tree var = build_local_temp (tsa);
+      result = compound_expr (build_vinit (var, ctor),
+			      build_nop (ptrtype, build_address (var)));
+    }
+  else
+    {
+      args[0] = build_typeinfo (etype->arrayOf());
+      args[1] = size_int(elements->dim);
+
+      // Call _d_arrayliteralTX (ti, dim);
+      tree mem = build_libcall (LIBCALL_ARRAYLITERALTX, 2, args, ptrtype);
+      mem = maybe_make_temp (mem);
+
+      // memcpy (mem, &ctor, size)
+      tree size = fold_build2 (MULT_EXPR, size_type_node,
+			       size_int (elements->dim), size_int (tb->nextOf()->size()));
+
+      result = d_build_call_nary (builtin_decl_explicit (BUILT_IN_MEMCPY), 3,
+				  mem, build_address (ctor), size);
+
+      // Returns array pointed to by MEM.
+      result = maybe_compound_expr (result, mem);
+    }
 
   if (tb->ty == Tarray)
     result = d_array_value (build_ctype(type), size_int (elements->dim), result);
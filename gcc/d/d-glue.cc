@@ -94,6 +94,7 @@ Global::increaseErrorCount()
     this->gaggedErrors++;
 
   this->errors++;
+  this->totalErrors++;
 }
 
 char *
@@ -134,6 +135,112 @@ Loc::equals(const Loc& loc)
 }
 
 
+// Diagnostics raised on a worker thread of the parallel parser.
+
+enum deferred_kind
+{
+  DEFER_ERROR,
+  DEFER_SUPPLEMENTAL,
+  DEFER_WARNING,
+  DEFER_DEPRECATION
+};
+
+struct DeferredDiagnostic
+{
+  deferred_kind kind;
+  Loc loc;
+  char *msg;
+};
+
+struct DeferredDiagnostics
+{
+  Array<DeferredDiagnostic *> diags;
+};
+
+// Where diagnostics are saved on the current thread, or NULL if they
+// should be emitted straight away.
+static THREAD_LOCAL DeferredDiagnostics *deferred_diagnostics;
+
+// Save the message built from FORMAT and AP, prefixed by P1 and P2 if
+// given, in the current thread's deferred diagnostics.
+
+static void
+defer_diagnostic(deferred_kind kind, Loc loc, const char *format, va_list ap,
+		 const char *p1 = NULL, const char *p2 = NULL)
+{
+  char *msg;
+
+  if (vasprintf(&msg, format, ap) < 0 || msg == NULL)
+    return;
+
+  if (p2)
+    msg = concat(p2, " ", msg, NULL);
+
+  if (p1)
+    msg = concat(p1, " ", msg, NULL);
+
+  DeferredDiagnostic *dd = XNEW (DeferredDiagnostic);
+  dd->kind = kind;
+  dd->loc = loc;
+  dd->msg = msg;
+  deferred_diagnostics->diags.push(dd);
+}
+
+// Start saving diagnostics raised on the current thread.
+
+DeferredDiagnostics *
+startDeferringDiagnostics()
+{
+  gcc_assert(deferred_diagnostics == NULL);
+  deferred_diagnostics = new DeferredDiagnostics;
+  return deferred_diagnostics;
+}
+
+// Stop saving diagnostics raised on the current thread.
+
+void
+stopDeferringDiagnostics()
+{
+  deferred_diagnostics = NULL;
+}
+
+// Emit all diagnostics saved in DD, in the order they were raised.
+// This goes through the same routines as a normal diagnostic would,
+// so gagging and error counting apply at the time of the call.
+
+void
+emitDeferredDiagnostics(DeferredDiagnostics *dd)
+{
+  for (size_t i = 0; i < dd->diags.dim; i++)
+    {
+      DeferredDiagnostic *d = dd->diags[i];
+
+      switch (d->kind)
+	{
+	case DEFER_ERROR:
+	  error(d->loc, "%s", d->msg);
+	  break;
+
+	case DEFER_SUPPLEMENTAL:
+	  errorSupplemental(d->loc, "%s", d->msg);
+	  break;
+
+	case DEFER_WARNING:
+	  warning(d->loc, "%s", d->msg);
+	  break;
+
+	case DEFER_DEPRECATION:
+	  deprecation(d->loc, "%s", d->msg);
+	  break;
+
+	default:
+	  gcc_unreachable();
+	}
+    }
+
+  dd->diags.setDim(0);
+}
+
 // Print a hard error message.
 
 void
@@ -149,6 +256,12 @@ void
 verror(Loc loc, const char *format, va_list ap,
        const char *p1, const char *p2, const char *)
 {
+  if (deferred_diagnostics)
+    {
+      defer_diagnostic(DEFER_ERROR, loc, format, ap, p1, p2);
+      return;
+    }
+
   if (!global.gag)
     {
       location_t location = get_linemap(loc);
@@ -174,6 +287,7 @@ verror(Loc loc, const char *format, va_list ap,
     global.gaggedErrors++;
 
   global.errors++;
+  global.totalErrors++;
 }
 
 // Print supplementary message about the last error.
@@ -191,6 +305,12 @@ errorSupplemental(Loc loc, const char *format, ...)
 void
 verrorSupplemental(Loc loc, const char *format, va_list ap)
 {
+  if (deferred_diagnostics)
+    {
+      defer_diagnostic(DEFER_SUPPLEMENTAL, loc, format, ap);
+      return;
+    }
+
   if (!global.gag)
     {
       location_t location = get_linemap(loc);
@@ -215,6 +335,12 @@ warning(Loc loc, const char *format, ...)
 void
 vwarning(Loc loc, const char *format, va_list ap)
 {
+  if (deferred_diagnostics)
+    {
+      defer_diagnostic(DEFER_WARNING, loc, format, ap);
+      return;
+    }
+
   if (global.params.warnings && !global.gag)
     {
       location_t location = get_linemap(loc);
@@ -244,6 +370,12 @@ void
 vdeprecation(Loc loc, const char *format, va_list ap,
 	      const char *p1, const char *p2)
 {
+  if (deferred_diagnostics)
+    {
+      defer_diagnostic(DEFER_DEPRECATION, loc, format, ap, p1, p2);
+      return;
+    }
+
   if (global.params.useDeprecated == 0)
     verror(loc, format, ap, p1, p2);
   else if (global.params.useDeprecated == 2 && !global.gag)
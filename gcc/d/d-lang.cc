@@ -24,9 +24,14 @@
 #include "dfrontend/mars.h"
 #include "dfrontend/mtype.h"
 #include "dfrontend/aggregate.h"
+#include "dfrontend/attrib.h"
 #include "dfrontend/cond.h"
+#include "dfrontend/expression.h"
+#include "dfrontend/ctfe.h"
 #include "dfrontend/hdrgen.h"
 #include "dfrontend/doc.h"
+#include "dfrontend/file.h"
+#include "dfrontend/import.h"
 #include "dfrontend/json.h"
 #include "dfrontend/lexer.h"
 #include "dfrontend/module.h"
@@ -34,6 +39,7 @@
 #include "dfrontend/statement.h"
 #include "dfrontend/root.h"
 #include "dfrontend/target.h"
+#include "dfrontend/template.h"
 
 #include "opts.h"
 #include "alias.h"
@@ -57,6 +63,15 @@
 #include "d-dmd-gcc.h"
 #include "id.h"
 
+#include <pthread.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
 static const char *iprefix_dir = NULL;
 static const char *imultilib_dir = NULL;
 
@@ -369,6 +384,10 @@ d_handle_option (size_t scode, const char *arg, int value,
       bounds_check_set_manually = true;
       break;
 
+    case OPT_fbounds_check_report:
+      global.params.boundsCheckReport = value;
+      break;
+
     case OPT_fdebug:
       global.params.debuglevel = value ? 1 : 0;
       break;
@@ -393,6 +412,21 @@ d_handle_option (size_t scode, const char *arg, int value,
       error ("bad argument for -fdebug '%s'", arg);
       break;
 
+    case OPT_fclosure_report:
+      global.params.closureReport = value;
+      break;
+
+    case OPT_fctfe_stats:
+      global.params.ctfeStats = value;
+      break;
+
+    case OPT_fctfe_stats_:
+      global.params.ctfeStats = true;
+      global.params.ctfeStatsFile = arg;
+      if (!global.params.ctfeStatsFile[0])
+	error ("bad argument for -fctfe-stats");
+      break;
+
     case OPT_fdeps:
       global.params.moduleDeps = new OutBuffer;
       break;
@@ -453,6 +487,10 @@ d_handle_option (size_t scode, const char *arg, int value,
       global.params.useInvariants = value;
       break;
 
+    case OPT_flazy_imports:
+      global.params.lazySemantic = value;
+      break;
+
     case OPT_fmake_deps:
       global.params.makeDeps = new OutBuffer;
       break;
@@ -507,6 +545,16 @@ d_handle_option (size_t scode, const char *arg, int value,
       global.params.useSwitchError = !value;
       break;
 
+    case OPT_ftemplate_stats:
+      global.params.templateStats = value;
+      break;
+
+    case OPT_ftime_trace_:
+      global.params.timeTraceFile = arg;
+      if (!global.params.timeTraceFile[0])
+	error ("bad argument for -ftime-trace");
+      break;
+
     case OPT_ftransition_field:
       global.params.vfield = value;
       break;
@@ -861,6 +909,760 @@ d_add_global_declaration(tree decl)
   vec_safe_push(global_declarations, decl);
 }
 
+// Lex all D source files found under directory DIR, recursively, adding
+// to the count of FILES and BYTES lexed, and the time in microseconds
+// spent lexing them in USECS.
+
+static void
+d_bench_lexer_dir(const char *dir, unsigned *files, unsigned long long *bytes,
+		  long *usecs)
+{
+  DIR *dirp = opendir(dir);
+  if (dirp == NULL)
+    {
+      error("cannot open directory %s", dir);
+      return;
+    }
+
+  struct dirent *entry;
+  while ((entry = readdir(dirp)) != NULL)
+    {
+      if (entry->d_name[0] == '.')
+	continue;
+
+      char *path = concat(dir, "/", entry->d_name, NULL);
+      struct stat st;
+
+      if (stat(path, &st) == 0)
+	{
+	  if (S_ISDIR (st.st_mode))
+	    d_bench_lexer_dir(path, files, bytes, usecs);
+	  else if (S_ISREG (st.st_mode) && FileName::equalsExt(path, "d"))
+	    {
+	      File file(path);
+
+	      // Only time the lexer, not reading the file.
+	      if (!file.mmread())
+		{
+		  long start = get_run_time();
+		  Lexer lex(path, file.buffer, 0, file.len, 0, 0);
+		  while (lex.nextToken() != TOKeof)
+		    ;
+		  *usecs += get_run_time() - start;
+		  *bytes += file.len;
+		  (*files)++;
+		}
+	    }
+	}
+
+      free(path);
+    }
+
+  closedir(dirp);
+}
+
+// Implements -fbench-lexer, lex all D source files under DIR and report
+// the throughput.
+
+static void
+d_bench_lexer(const char *dir)
+{
+  unsigned files = 0;
+  unsigned long long bytes = 0;
+  long usecs = 0;
+
+  d_bench_lexer_dir(dir, &files, &bytes, &usecs);
+
+  double secs = usecs / 1e6;
+  fprintf(stderr, "lexed %u files, %llu bytes in %.3f seconds",
+	  files, bytes, secs);
+  if (usecs > 0)
+    fprintf(stderr, ", %.2f MB/s", (bytes / 1e6) / secs);
+  fprintf(stderr, "\n");
+}
+
+// Implements the visitor interface to find all imports that will always
+// be loaded by a module, so they can be read and parsed ahead of time.
+// Imports inside conditional compilation blocks are not followed, as the
+// condition can't be known until semantic.
+
+class ParseAheadVisitor : public Visitor
+{
+public:
+  Modules *modules;
+
+  ParseAheadVisitor(Modules *modules) : modules(modules) {}
+
+  void visit(Dsymbol *)
+  {
+  }
+
+  void visit(Import *imp)
+  {
+    Module *m = Module::prefetch(imp->loc, imp->packages, imp->id);
+    if (m != NULL)
+      modules->push(m);
+  }
+
+  void visit(AttribDeclaration *d)
+  {
+    if (d->decl == NULL)
+      return;
+
+    for (size_t i = 0; i < d->decl->dim; i++)
+      (*d->decl)[i]->accept(this);
+  }
+
+  void visit(ConditionalDeclaration *)
+  {
+  }
+};
+
+// State shared between the threads of a parse ahead pool.
+
+struct parse_ahead_pool
+{
+  Modules *modules;
+  size_t next;
+  size_t idbase;
+  size_t idmax;
+  pthread_mutex_t mutex;
+};
+
+// Worker thread for d_parse_ahead, takes modules off the pool until none
+// are left.  Every module numbers its generated identifiers from the same
+// base, so that the names don't depend on which thread parsed what.
+
+static void *
+parse_ahead_worker(void *arg)
+{
+  parse_ahead_pool *pool = (parse_ahead_pool *) arg;
+
+  while (1)
+    {
+      pthread_mutex_lock(&pool->mutex);
+      Module *m = (pool->next < pool->modules->dim)
+	? (*pool->modules)[pool->next++] : NULL;
+      pthread_mutex_unlock(&pool->mutex);
+
+      if (m == NULL)
+	break;
+
+      Identifier::setGeneratedIdCount(pool->idbase);
+      m->parseAhead();
+
+      pthread_mutex_lock(&pool->mutex);
+      if (Identifier::getGeneratedIdCount() > pool->idmax)
+	pool->idmax = Identifier::getGeneratedIdCount();
+      pthread_mutex_unlock(&pool->mutex);
+    }
+
+  pthread_mutex_lock(&pool->mutex);
+  allocmemory_threadexit();
+  pthread_mutex_unlock(&pool->mutex);
+
+  return NULL;
+}
+
+// Read and parse all MODULES using NTHREADS threads.
+
+static void
+d_parse_ahead_wave(Modules *modules, int nthreads)
+{
+  parse_ahead_pool pool;
+  pool.modules = modules;
+  pool.next = 0;
+  pool.idbase = Identifier::getGeneratedIdCount();
+  pool.idmax = pool.idbase;
+  pthread_mutex_init(&pool.mutex, NULL);
+
+  if ((size_t) nthreads > modules->dim)
+    nthreads = modules->dim;
+
+  pthread_t *threads = XNEWVEC (pthread_t, nthreads);
+  int nstarted = 0;
+
+  Port::threaded = true;
+  for (int i = 0; i < nthreads; i++)
+    {
+      if (pthread_create(&threads[i], NULL, parse_ahead_worker, &pool) != 0)
+	break;
+      nstarted++;
+    }
+
+  // If no threads could be started, whatever is left gets parsed on demand.
+  for (int i = 0; i < nstarted; i++)
+    pthread_join(threads[i], NULL);
+  Port::threaded = false;
+
+  Identifier::setGeneratedIdCount(pool.idmax);
+  pthread_mutex_destroy(&pool.mutex);
+  XDELETEVEC (threads);
+}
+
+// Read and parse the root MODULES, and then all modules they import,
+// one level of imports at a time, using NTHREADS threads.
+// The modules are only syntactically parsed, Module::parse still has to
+// be called on each of them from the main thread, which emits any
+// diagnostics in the order a serial parse would have.
+
+static void
+d_parse_ahead(Modules& modules, int nthreads)
+{
+  Modules wave;
+  wave.append(&modules);
+
+  // Every module imports object.
+  Module *m = Module::prefetch(Loc(), NULL, Id::object);
+  if (m != NULL)
+    wave.push(m);
+
+  while (wave.dim)
+    {
+      d_parse_ahead_wave(&wave, nthreads);
+
+      Modules imports;
+      ParseAheadVisitor v(&imports);
+
+      for (size_t i = 0; i < wave.dim; i++)
+	{
+	  m = wave[i];
+	  if (!m->preparsed || m->members == NULL)
+	    continue;
+
+	  for (size_t j = 0; j < m->members->dim; j++)
+	    (*m->members)[j]->accept(&v);
+	}
+
+      wave.setDim(0);
+      wave.append(&imports);
+    }
+}
+
+// Compile server.  With -fcompile-server-listen=SOCKET, the modules on
+// the command line and everything they import are analyzed once, then
+// a background copy of cc1d listens on the Unix socket SOCKET until it is
+// removed.  For each request it forks, and the child compiles the
+// request's modules against the analyzed modules it inherited, writing
+// to the client's assembler output.
+// With -fcompile-server=SOCKET, cc1d hands its compilation over to the
+// server listening on SOCKET, if there is one and its options match.
+//
+// A request passes the client's assembler output, stdout and stderr as
+// file descriptors, followed by NUL terminated strings: the options,
+// the working directory and the input files, ending with an empty
+// string.  The reply is one of the following bytes.
+
+enum compile_server_status
+{
+  COMPILE_SERVER_SUCCESS,	// compiled without errors
+  COMPILE_SERVER_FAILURE,	// compiled, and errors were reported
+  COMPILE_SERVER_REFUSED	// options differ, input analyzed or changed, compile locally
+};
+
+// The source file of a module the compile server analyzed, with its size
+// and modification time when the server started listening.
+
+struct compile_server_source
+{
+  char *path;
+  off_t size;
+  time_t mtime;
+};
+
+// In a child of the compile server, the modules the server analyzed,
+// which are imports of the request's modules, the template instances
+// the request's output module emits for them, and the connection to the
+// client.
+
+static Modules *compile_server_imports = NULL;
+static Dsymbols *compile_server_instances = NULL;
+static int compile_server_client = -1;
+
+// Write the options that must be the same for the server and the client
+// to BUF, leaving out the names of the input and output files.
+
+static void
+d_compile_server_options(OutBuffer *buf)
+{
+  buf->writestring(global.version);
+  buf->writeByte('\n');
+
+  for (unsigned i = 1; i < save_decoded_options_count; i++)
+    {
+      cl_decoded_option *opt = &save_decoded_options[i];
+      switch (opt->opt_index)
+	{
+	case OPT_SPECIAL_input_file:
+	case OPT_o:
+	case OPT_dumpbase:
+	case OPT_auxbase:
+	case OPT_auxbase_strip:
+	case OPT_fcompile_server_:
+	case OPT_fcompile_server_listen_:
+	  continue;
+
+	default:
+	  buf->writestring(opt->orig_option_with_args_text);
+	  buf->writeByte('\n');
+	}
+    }
+  buf->writeByte(0);
+}
+
+// Write LEN bytes of DATA to FD, returns false on error.
+
+static bool
+d_write_all(int fd, const void *data, size_t len)
+{
+  const char *p = (const char *) data;
+  while (len)
+    {
+      ssize_t n = write(fd, p, len);
+      if (n < 0 && errno == EINTR)
+	continue;
+      if (n <= 0)
+	return false;
+      p += n;
+      len -= n;
+    }
+  return true;
+}
+
+// Send or receive the NFDS file descriptors in FDS over SOCK.
+
+static bool
+d_send_fds(int sock, int *fds, int nfds)
+{
+  char byte = 0;
+  struct iovec iov = { &byte, 1 };
+  union
+  {
+    struct cmsghdr hdr;
+    char buf[CMSG_SPACE (3 * sizeof(int))];
+  } control;
+  gcc_assert(nfds <= 3);
+
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = CMSG_SPACE (nfds * sizeof(int));
+
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR (&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN (nfds * sizeof(int));
+  memcpy(CMSG_DATA (cmsg), fds, nfds * sizeof(int));
+
+  return sendmsg(sock, &msg, 0) == 1;
+}
+
+static bool
+d_recv_fds(int sock, int *fds, int nfds)
+{
+  char byte;
+  struct iovec iov = { &byte, 1 };
+  union
+  {
+    struct cmsghdr hdr;
+    char buf[CMSG_SPACE (3 * sizeof(int))];
+  } control;
+  gcc_assert(nfds <= 3);
+
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = CMSG_SPACE (nfds * sizeof(int));
+
+  if (recvmsg(sock, &msg, 0) != 1)
+    return false;
+
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR (&msg);
+  if (cmsg == NULL || cmsg->cmsg_level != SOL_SOCKET
+      || cmsg->cmsg_type != SCM_RIGHTS
+      || cmsg->cmsg_len != CMSG_LEN (nfds * sizeof(int)))
+    return false;
+
+  memcpy(fds, CMSG_DATA (cmsg), nfds * sizeof(int));
+  return true;
+}
+
+// Read the strings of a request from SOCK into ARGS.
+
+static bool
+d_recv_strings(int sock, Strings *args)
+{
+  OutBuffer buf;
+  size_t start = 0;
+
+  while (1)
+    {
+      char c;
+      ssize_t n = read(sock, &c, 1);
+      if (n < 0 && errno == EINTR)
+	continue;
+      if (n != 1)
+	return false;
+
+      buf.writeByte(c);
+      if (c != 0)
+	continue;
+
+      if (buf.offset - 1 == start)
+	break;			// empty string ends the request
+      start = buf.offset;
+    }
+
+  char *data = buf.extractData();
+  for (char *p = data; *p; p += strlen(p) + 1)
+    args->push(p);
+  return true;
+}
+
+// Returns true if one of the input files in ARGS, relative to the working
+// directory that comes first, is the source of a module in ANALYZED.
+// Compiling it again would make two modules of the same name.
+
+static bool
+d_compile_server_analyzed(Strings *args,
+			  Array<compile_server_source *> *analyzed)
+{
+  for (unsigned i = 2; i < args->dim; i++)
+    {
+      const char *name = (*args)[i];
+      char *path = IS_ABSOLUTE_PATH (name)
+	? xstrdup(name) : concat((*args)[1], "/", name, NULL);
+      char *real = lrealpath(path);
+      free(path);
+
+      bool found = false;
+      for (unsigned j = 0; j < analyzed->dim && !found; j++)
+	found = FILENAME_CMP (real, (*analyzed)[j]->path) == 0;
+      free(real);
+
+      if (found)
+	return true;
+    }
+  return false;
+}
+
+// Returns true if the source of a module in ANALYZED changed since it was
+// analyzed, so that compiling against it would use stale declarations.
+
+static bool
+d_compile_server_stale(Array<compile_server_source *> *analyzed)
+{
+  for (unsigned i = 0; i < analyzed->dim; i++)
+    {
+      compile_server_source *src = (*analyzed)[i];
+      struct stat st;
+      if (stat(src->path, &st) != 0
+	  || st.st_size != src->size || st.st_mtime != src->mtime)
+	return true;
+    }
+  return false;
+}
+
+// In a child of the compile server, the template instances created by
+// the server's root modules are kept in their members, and those modules
+// emit them.  They are now imports, so make OUTPUT emit the instances
+// instead, as the request may use them.  Must be called while the
+// server's modules are still root modules.
+
+static void
+d_compile_server_reroot(Modules *imports, Module *output)
+{
+  compile_server_instances = new Dsymbols();
+
+  for (size_t i = 0; i < imports->dim; i++)
+    {
+      Module *m = (*imports)[i];
+      if (!m->isRoot() || !m->members)
+	continue;
+
+      for (size_t j = 0; j < m->members->dim; j++)
+	{
+	  TemplateInstance *ti = (*m->members)[j]->isTemplateInstance();
+	  if (ti == NULL || ti->isTemplateMixin())
+	    continue;
+
+	  if (ti->minst && ti->minst->isRoot())
+	    {
+	      ti->minst = output;
+	      compile_server_instances->push(ti);
+	    }
+	}
+    }
+}
+
+// Returns true if the client connected on SOCK runs as the same user as
+// the server, which is the only one allowed to make requests.
+
+static bool
+d_compile_server_peer_ok(int sock)
+{
+#ifdef SO_PEERCRED
+  struct ucred cred;
+  socklen_t len = sizeof(cred);
+  if (getsockopt(sock, SOL_SOCKET, SO_PEERCRED, &cred, &len) != 0)
+    return false;
+  return cred.uid == geteuid();
+#else
+  // Only the owner can connect to the socket, see d_serve_compiles.
+  (void) sock;
+  return true;
+#endif
+}
+
+// Runs when a child of the compile server exits, to tell the client the
+// compilation is done.
+
+static void
+d_compile_server_reply()
+{
+  if (asm_out_file)
+    fflush(asm_out_file);
+  fflush(stdout);
+  fflush(stderr);
+
+  char status = seen_error() ? COMPILE_SERVER_FAILURE : COMPILE_SERVER_SUCCESS;
+  d_write_all(compile_server_client, &status, 1);
+}
+
+// Implements -fcompile-server-listen, serve compilations on the socket
+// at PATH from a background process, which stops when PATH is removed.
+// Returns false in this process once the server is listening, or true in
+// a forked child, after making the input files of a request the ones to
+// compile.
+
+static bool
+d_serve_compiles(const char *path)
+{
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(addr.sun_path))
+    fatal_error(input_location, "compile server socket name too long: %s",
+		path);
+  strcpy(addr.sun_path, path);
+
+  // The socket is created with no permissions for the group and others,
+  // so that requests run with the server's rights only come from its user.
+  int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+  unlink(path);
+  mode_t mask = umask(077);
+  bool bound = sock >= 0
+    && bind(sock, (struct sockaddr *) &addr, sizeof(addr)) == 0;
+  umask(mask);
+  struct stat bound_st;
+  if (!bound || listen(sock, SOMAXCONN) != 0 || stat(path, &bound_st) != 0)
+    fatal_error(input_location, "cannot listen on %s: %m", path);
+
+  OutBuffer options;
+  d_compile_server_options(&options);
+
+  // The files of the modules analyzed.  A request to compile one of them
+  // again is refused, as are all requests once one of them changed.
+  Array<compile_server_source *> analyzed;
+  for (size_t i = 0; i < Module::amodules.dim; i++)
+    {
+      File *srcfile = Module::amodules[i]->srcfile;
+      compile_server_source *src = XNEW (compile_server_source);
+      struct stat st;
+
+      src->path = lrealpath(srcfile->name->str);
+      src->size = -1;
+      src->mtime = 0;
+      if (stat(src->path, &st) == 0)
+	{
+	  src->size = st.st_size;
+	  src->mtime = st.st_mtime;
+	}
+      analyzed.push(src);
+    }
+
+  // The server must not write out what is buffered so far.
+  fflush(asm_out_file);
+  fflush(stdout);
+  fflush(stderr);
+
+  pid_t server = fork();
+  if (server < 0)
+    fatal_error(input_location, "cannot start compile server: %m");
+  if (server > 0)
+    {
+      close(sock);
+      return false;
+    }
+
+  // The server outlives this compilation, so detach it from the terminal
+  // and from the output of the compiler driver.
+  setsid();
+  fclose(asm_out_file);
+  asm_out_file = NULL;
+  int devnull = open("/dev/null", O_RDWR);
+  if (devnull >= 0)
+    {
+      dup2(devnull, 0);
+      dup2(devnull, 1);
+      dup2(devnull, 2);
+      close(devnull);
+    }
+
+  // Children are not waited for, their clients are.
+  signal(SIGCHLD, SIG_IGN);
+
+  while (1)
+    {
+      // Stop once the socket is removed or replaced.
+      struct pollfd pfd;
+      pfd.fd = sock;
+      pfd.events = POLLIN;
+      pfd.revents = 0;
+      if (poll(&pfd, 1, 1000) <= 0)
+	{
+	  struct stat st;
+	  if (stat(path, &st) != 0 || st.st_dev != bound_st.st_dev
+	      || st.st_ino != bound_st.st_ino)
+	    _exit(SUCCESS_EXIT_CODE);
+	  continue;
+	}
+
+      int client = accept(sock, NULL, NULL);
+      if (client < 0)
+	{
+	  if (errno == EINTR || errno == ECONNABORTED)
+	    continue;
+	  fatal_error(input_location, "cannot accept on %s: %m", path);
+	}
+
+      int fds[3];
+      Strings args;
+      if (!d_compile_server_peer_ok(client) || !d_recv_fds(client, fds, 3))
+	{
+	  close(client);
+	  continue;
+	}
+
+      pid_t pid = -1;
+      if (d_recv_strings(client, &args) && args.dim >= 3
+	  && strcmp(args[0], (char *) options.data) == 0
+	  && !d_compile_server_analyzed(&args, &analyzed)
+	  && !d_compile_server_stale(&analyzed))
+	pid = fork();
+
+      if (pid < 0)
+	{
+	  char status = COMPILE_SERVER_REFUSED;
+	  d_write_all(client, &status, 1);
+	}
+      else if (pid == 0)
+	{
+	  close(sock);
+	  signal(SIGCHLD, SIG_DFL);
+
+	  compile_server_client = client;
+	  atexit(d_compile_server_reply);
+
+	  dup2(fds[1], 1);
+	  dup2(fds[2], 2);
+	  close(fds[1]);
+	  close(fds[2]);
+	  asm_out_file = fdopen(fds[0], "w");
+
+	  if (chdir(args[1]) != 0)
+	    fatal_error(input_location, "cannot change directory to %s: %m",
+			args[1]);
+
+	  num_in_fnames = args.dim - 2;
+	  in_fnames = XNEWVEC (const char *, num_in_fnames);
+	  for (unsigned i = 0; i < num_in_fnames; i++)
+	    in_fnames[i] = args[i + 2];
+	  main_input_filename = in_fnames[0];
+	  return true;
+	}
+
+      close(client);
+      close(fds[0]);
+      close(fds[1]);
+      close(fds[2]);
+    }
+}
+
+// Implements -fcompile-server, hand this compilation over to the server
+// listening on PATH, and exit with its status.  Returns if there is no
+// server, or it refused because its options differ, an input file is
+// one it analyzed or one of those changed, for the compilation to be done
+// here.  Compilations
+// with debugging information are always done here, as the server began
+// its debugging information with its own main source file.
+
+static void
+d_compile_remote(const char *path)
+{
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (asm_out_file == NULL || strlen(path) >= sizeof(addr.sun_path)
+      || debug_info_level != DINFO_LEVEL_NONE)
+    return;
+  strcpy(addr.sun_path, path);
+
+  int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (sock < 0)
+    return;
+  if (connect(sock, (struct sockaddr *) &addr, sizeof(addr)) != 0)
+    {
+      close(sock);
+      return;
+    }
+
+  OutBuffer request;
+  d_compile_server_options(&request);
+  request.writestring(getpwd());
+  request.writeByte(0);
+  for (unsigned i = 0; i < num_in_fnames; i++)
+    {
+      request.writestring(in_fnames[i]);
+      request.writeByte(0);
+    }
+  request.writeByte(0);
+
+  // The server appends to what was written to the output so far.
+  fflush(asm_out_file);
+  fflush(stdout);
+  fflush(stderr);
+
+  int fds[3] = { fileno(asm_out_file), fileno(stdout), fileno(stderr) };
+  char status;
+  ssize_t n = -1;
+
+  if (d_send_fds(sock, fds, 3)
+      && d_write_all(sock, request.data, request.offset))
+    {
+      do
+	n = read(sock, &status, 1);
+      while (n < 0 && errno == EINTR);
+    }
+  close(sock);
+
+  if (n == 1 && status == COMPILE_SERVER_REFUSED)
+    return;
+
+  if (n != 1)
+    {
+      // Whatever the server wrote to the output can't be taken back.
+      error("compile server on %s did not finish", path);
+      exit(FATAL_EXIT_CODE);
+    }
+
+  exit(status == COMPILE_SERVER_SUCCESS ? SUCCESS_EXIT_CODE : FATAL_EXIT_CODE);
+}
+
 void
 d_parse_file()
 {
@@ -870,6 +1672,15 @@ d_parse_file()
       fprintf(global.stdmsg, "version   %s\n", global.version);
     }
 
+  if (flag_bench_lexer)
+    {
+      d_bench_lexer(flag_bench_lexer);
+      return;
+    }
+
+  if (flag_compile_server)
+    d_compile_remote(flag_compile_server);
+
   // Start the main input file, if the debug writer wants it.
   if (debug_hooks->start_end_main_source_file)
     (*debug_hooks->start_source_file)(0, main_input_filename);
@@ -880,6 +1691,8 @@ d_parse_file()
 	d_nametype(Type::basic[ty]);
     }
 
+  // A child of the compile server starts here with the request's files.
+ compile_request:
   // Create Modules
   Modules modules;
   modules.reserve(num_in_fnames);
@@ -972,6 +1785,9 @@ d_parse_file()
       m->read(Loc());
     }
 
+  if (flag_parallel_parse > 1)
+    d_parse_ahead(modules, flag_parallel_parse);
+
   // Parse files
   for (size_t i = 0; i < modules.dim; i++)
     {
@@ -996,6 +1812,15 @@ d_parse_file()
 	}
     }
 
+  // The modules analyzed by the compile server are imported by this
+  // compilation, and no longer root modules.
+  if (compile_server_imports)
+    {
+      d_compile_server_reroot(compile_server_imports, output_module);
+      for (size_t i = 0; i < compile_server_imports->dim; i++)
+	(*compile_server_imports)[i]->importedFrom = output_module;
+    }
+
   if (global.errors)
     goto had_errors;
 
@@ -1098,6 +1923,34 @@ d_parse_file()
 
   Module::runDeferredSemantic3();
 
+  if (global.params.verbose)
+    {
+      printCtfePerformanceStats();
+      fprintf(global.stdmsg, "import lookups: %llu searched, %llu found in cache\n",
+	      (unsigned long long) ScopeDsymbol::numSearchCacheMisses,
+	      (unsigned long long) ScopeDsymbol::numSearchCacheHits);
+      if (global.params.lazySemantic)
+	fprintf(global.stdmsg, "lazy imports: %llu deferred, %llu analyzed\n",
+		(unsigned long long) Module::numLazyMembers,
+		(unsigned long long) Module::numLazyAnalyzed);
+    }
+
+  if (global.params.ctfeStats)
+    {
+      OutBuffer buf;
+      printCtfeProfile (&buf);
+
+      if (global.params.ctfeStatsFile)
+	{
+	  File stats(global.params.ctfeStatsFile);
+	  stats.setbuffer((void *) buf.data, buf.offset);
+	  stats.ref = 1;
+	  writeFile(Loc(), &stats);
+	}
+      else
+	fprintf(global.stdmsg, "%.*s", (int) buf.offset, (char *) buf.data);
+    }
+
   // Check again, incase semantic3 pass loaded any more modules.
   while (builtin_modules.dim != 0)
     {
@@ -1105,10 +1958,44 @@ d_parse_file()
       d_maybe_set_builtin(m);
     }
 
+  // Only report once all modules have been loaded and analyzed.
+  if (global.params.templateStats)
+    {
+      OutBuffer buf;
+      printTemplateStats (&buf);
+      fprintf(global.stdmsg, "%.*s", (int) buf.offset, (char *) buf.data);
+    }
+
+  if (global.params.timeTraceFile)
+    {
+      OutBuffer buf;
+      printTemplateTrace (&buf);
+
+      File trace(global.params.timeTraceFile);
+      trace.setbuffer((void *) buf.data, buf.offset);
+      trace.ref = 1;
+      writeFile(Loc(), &trace);
+    }
+
   // Do not attempt to generate output files if errors or warnings occurred
   if (global.errors || global.warnings)
     goto had_errors;
 
+  if (flag_compile_server_listen)
+    {
+      // This compilation ends with no code once the server is listening.
+      if (!d_serve_compiles(flag_compile_server_listen))
+	goto had_errors;
+
+      // In a forked child, compile the request against what was analyzed.
+      compile_server_imports = new Modules();
+      compile_server_imports->append(&Module::amodules);
+      flag_compile_server_listen = NULL;
+      Module::rootModule = NULL;
+      output_module = NULL;
+      goto compile_request;
+    }
+
   if (global.params.moduleDeps)
     {
       OutBuffer *ob = global.params.moduleDeps;
@@ -1195,6 +2082,11 @@ d_parse_file()
 	}
     }
 
+  // Emit the template instances of the compile server's modules that the
+  // request may use, see d_compile_server_reroot.
+  if (compile_server_instances)
+    output_module->members->append(compile_server_instances);
+
   for (size_t i = 0; i < modules.dim; i++)
     {
       Module *m = modules[i];
@@ -1213,6 +2105,10 @@ d_parse_file()
 	}
     }
 
+  if (global.params.boundsCheckReport)
+    fprintf(global.stdmsg, "bounds checks: %u emitted, %u removed\n",
+	    bounds_checks_emitted, bounds_checks_removed);
+
   // And end the main input file, if the debug writer wants it.
   if (debug_hooks->start_end_main_source_file)
     (*debug_hooks->end_source_file)(0);
@@ -1221,6 +2117,9 @@ d_parse_file()
   // Add D frontend error count to GCC error count to to exit with error status
   errorcount += (global.errors + global.warnings);
 
+  if (mem_report)
+    allocmemory_report(stderr);
+
   d_finish_module();
 
   // Write out globals.
@@ -1420,9 +2319,49 @@ d_get_alias_set (tree t)
   if (!TYPE_P (t))
     return get_alias_set (TREE_TYPE (t));
 
-  // For now in D, assume everything aliases everything else,
-  // until we define some solid rules.
-  return 0;
+  // Any memory can be accessed as bytes, such as when it's sliced as
+  // a void[] or ubyte[], so those alias everything else.
+  if (TREE_CODE (t) == VOID_TYPE
+      || (INTEGRAL_TYPE_P (t) && int_size_in_bytes (t) == 1))
+    return 0;
+
+  // Signed and unsigned integers, characters and enums of the same size
+  // all alias each other, use the signed integer type for all of them.
+  if (INTEGRAL_TYPE_P (t))
+    {
+      tree type = d_type_for_size (TYPE_PRECISION (t), 0);
+      if (type != NULL_TREE && TYPE_MAIN_VARIANT (type) != t)
+	return get_alias_set (type);
+
+      return -1;
+    }
+
+  // Vectors alias their element type, as they are commonly accessed as
+  // static arrays.
+  if (TREE_CODE (t) == VECTOR_TYPE)
+    return get_alias_set (TREE_TYPE (t));
+
+  // Class objects can be accessed through any of their base classes or
+  // interfaces, and any class reference can refer to an object of any
+  // derived class, as can elements of covariant arrays.  So only use the
+  // types of class fields, and let all class references alias each other.
+  if (TREE_CODE (t) == RECORD_TYPE && CLASS_TYPE_P (t))
+    return 0;
+
+  if (POINTER_TYPE_P (t) && TREE_CODE (TREE_TYPE (t)) == RECORD_TYPE
+      && CLASS_TYPE_P (TREE_TYPE (t)))
+    {
+      static alias_set_type class_reference_set = -1;
+
+      if (class_reference_set == -1)
+	class_reference_set = new_alias_set ();
+
+      return class_reference_set;
+    }
+
+  // Qualified types share the alias set of their main variant.  Data
+  // that is immutable is still written when it is first constructed.
+  return -1;
 }
 
 static int
@@ -24,10 +24,15 @@
 #include "tree.h"
 #include "stor-layout.h"
 
+#include <pthread.h>
+
 longdouble Port::ldbl_nan;
 longdouble Port::snan;
 longdouble Port::ldbl_infinity;
 longdouble Port::ldbl_max;
+bool Port::threaded;
+
+static pthread_mutex_t port_mutex;
 
 void
 Port::init()
@@ -41,6 +46,14 @@ Port::init()
 
   get_max_float(REAL_MODE_FORMAT (mode), buf, sizeof(buf));
   real_from_string(&ldbl_max.rv(), buf);
+
+  // Type construction takes the lock and then merges types and
+  // interns identifiers, which take it again.
+  pthread_mutexattr_t attr;
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+  pthread_mutex_init(&port_mutex, &attr);
+  pthread_mutexattr_destroy(&attr);
 }
 
 // Returns TRUE if longdouble value R is NaN.
@@ -150,11 +163,14 @@ longdouble
 Port::strtof(const char *buffer, char **)
 {
   longdouble r;
+  // The middle-end real number routines are not thread-safe.
+  Port::lock();
   real_from_string3(&r.rv(), buffer, TYPE_MODE (float_type_node));
 
   // Front-end checks errno to see if the value is representable.
   if (r == ldbl_infinity)
     errno = ERANGE;
+  Port::unlock();
 
   return r;
 }
@@ -165,11 +181,14 @@ longdouble
 Port::strtod(const char *buffer, char **)
 {
   longdouble r;
+  // The middle-end real number routines are not thread-safe.
+  Port::lock();
   real_from_string3(&r.rv(), buffer, TYPE_MODE (double_type_node));
 
   // Front-end checks errno to see if the value is representable.
   if (r == ldbl_infinity)
     errno = ERANGE;
+  Port::unlock();
 
   return r;
 }
@@ -180,7 +199,28 @@ longdouble
 Port::strtold(const char *buffer, char **)
 {
   longdouble r;
+  // The middle-end real number routines are not thread-safe.
+  Port::lock();
   real_from_string3(&r.rv(), buffer, TYPE_MODE (long_double_type_node));
+  Port::unlock();
   return r;
 }
 
+// Acquire the lock protecting frontend state shared between threads
+// of the parallel parser.
+
+void
+Port::lock()
+{
+  if (threaded)
+    pthread_mutex_lock(&port_mutex);
+}
+
+// Release the lock acquired by Port::lock.
+
+void
+Port::unlock()
+{
+  if (threaded)
+    pthread_mutex_unlock(&port_mutex);
+}
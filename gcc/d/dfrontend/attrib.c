@@ -171,9 +171,15 @@ void AttribDeclaration::semantic(Scope *sc)
     {
         Scope *sc2 = newScope(sc);
 
+        // Members of attribute blocks at module level can be deferred
+        // like any other, see Module::deferSemantic().
+        Module *m = sc->scopesym ? sc->scopesym->isModule() : NULL;
+
         for (size_t i = 0; i < d->dim; i++)
         {
             Dsymbol *s = (*d)[i];
+            if (m && m->deferSemantic(s, sc2))
+                continue;
             s->semantic(sc2);
         }
 
@@ -189,10 +195,13 @@ void AttribDeclaration::semantic2(Scope *sc)
     if (d)
     {
         Scope *sc2 = newScope(sc);
+        Module *m = sc->scopesym ? sc->scopesym->isModule() : NULL;
 
         for (size_t i = 0; i < d->dim; i++)
         {
             Dsymbol *s = (*d)[i];
+            if (m && m->isLazyPending(s))
+                continue;
             s->semantic2(sc2);
         }
 
@@ -208,10 +217,13 @@ void AttribDeclaration::semantic3(Scope *sc)
     if (d)
     {
         Scope *sc2 = newScope(sc);
+        Module *m = sc->scopesym ? sc->scopesym->isModule() : NULL;
 
         for (size_t i = 0; i < d->dim; i++)
         {
             Dsymbol *s = (*d)[i];
+            if (m && m->isLazyPending(s))
+                continue;
             s->semantic3(sc2);
         }
 
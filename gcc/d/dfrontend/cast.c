@@ -2179,7 +2179,11 @@ Expression *castTo(Expression *e, Scope *sc, Type *t)
                             int offset;
                             if (f->tintro && f->tintro->nextOf()->isBaseOf(f->type->nextOf(), &offset) && offset)
                                 e->error("%s", msg);
-                            f->tookAddressOf++;
+                            /* The address of a nested function was counted
+                             * when the delegate was formed in AddrExp::semantic.
+                             */
+                            if (!f->isNested())
+                                f->tookAddressOf++;
                             result = new DelegateExp(e->loc, e->e1, f);
                             result->type = t;
                             return;
@@ -2193,7 +2197,8 @@ Expression *castTo(Expression *e, Scope *sc, Type *t)
             else
             {
                 int offset;
-                e->func->tookAddressOf++;
+                if (!e->func->isNested())
+                    e->func->tookAddressOf++;
                 if (e->func->tintro && e->func->tintro->nextOf()->isBaseOf(e->func->type->nextOf(), &offset) && offset)
                     e->error("%s", msg);
                 result = e->copy();
@@ -37,6 +37,7 @@ ClassDeclaration *ClassDeclaration::object;
 ClassDeclaration *ClassDeclaration::throwable;
 ClassDeclaration *ClassDeclaration::exception;
 ClassDeclaration *ClassDeclaration::errorException;
+ClassDeclarations ClassDeclaration::allClasses;
 
 ClassDeclaration::ClassDeclaration(Loc loc, Identifier *id, BaseClasses *baseclasses, bool inObject)
     : AggregateDeclaration(loc, id)
@@ -825,6 +826,7 @@ Lancestorsdone:
 
     Module::dprogress++;
     semanticRun = PASSsemanticdone;
+    allClasses.push(this);
 
     dtor = buildDtor(this, sc2);
     if (FuncDeclaration *f = hasIdentityOpAssign(this, sc2))
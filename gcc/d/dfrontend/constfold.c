@@ -1604,8 +1604,8 @@ int sliceCmpStringWithArray(StringExp *se1, ArrayLiteralExp *ae2, size_t lo1, si
         unsigned val1;
         switch (sz)
         {
-            case 1:     val1 = (( utf8_t *)s)[j + lo1]; break;
-            case 2:     val1 = ((utf16_t *)s)[j + lo1]; break;
+            case 1:     val1 = (( utf8_t *)s)[j + lo1]; val2 = ( utf8_t)val2;   break;
+            case 2:     val1 = ((utf16_t *)s)[j + lo1]; val2 = (utf16_t)val2;   break;
             case 4:     val1 = ((utf32_t *)s)[j + lo1]; break;
             default:    assert(0);                      break;
         }
@@ -19,6 +19,9 @@
 #include "arraytypes.h"
 #include "tokens.h"
 
+struct CtfeVmCode;
+struct OutBuffer;
+
 /**
    Global status of the CTFE engine. Mostly used for performance diagnostics
  */
@@ -31,8 +34,16 @@ struct CtfeStatus
     static int maxCallDepth; // highest number of recursive calls
     static int numArrayAllocs; // Number of allocated arrays
     static int numAssignments; // total number of assignments executed
+    static int numVmCalls; // calls executed by the bytecode VM
+    static int numInterpretedCalls; // calls executed by the AST interpreter
+    static int numVmFallbacks; // VM calls handed back to the AST interpreter
+    static int numMemoHits; // pure function calls answered from the memo cache
+    static int numMemoMisses; // pure function calls that were not
 };
 
+// Maximum allowable recursive function calls in CTFE
+#define CTFE_RECURSION_LIMIT 1000
+
 /**
   A reference to a class, or an interface. We need this when we
   point to a base class (we must record what the type is).
@@ -191,6 +202,30 @@ Expression *assignAssocArrayElement(Loc loc, AssocArrayLiteralExp *aae,
 UnionExp changeArrayLiteralLength(Loc loc, TypeArray *arrayType,
     Expression *oldval,  size_t oldlen, size_t newlen);
 
+/// Return true if CTFE stores arrays with element type t natively, in a StringExp.
+bool isCtfeNativeElement(Type *t);
+
+/// Return true if e is an array of integers which CTFE stores in a StringExp.
+bool isCtfeNativeArray(Expression *e);
+
+/// Convert the natively stored integer array se into an array literal.
+ArrayLiteralExp *nativeArrayToLiteral(StringExp *se);
+
+/// Find the StringExp or ArrayLiteralExp that the array e is a slice of, and
+/// the bounds of the slice.  *pagg is NULL for a null array.
+/// Returns false if e is not an interpreted array.
+bool getArrayBounds(Expression *e, Expression **pagg, size_t *plwr, size_t *plen);
+
+/// Append newval to the dynamic array oldval of type 'type', as for ~=.
+/// newval is a single element if isElement, otherwise an array.
+/// Returns a slice of an append buffer, or NULL if ctfeCat must be used.
+Expression *ctfeAppend(Loc loc, Type *type, Expression *oldval, Expression *newval, bool isElement);
+
+/// Lengthen the dynamic array oldval to newlen, as for arr.length = newlen.
+/// Returns a slice of an append buffer, or NULL if changeArrayLiteralLength
+/// must be used.
+Expression *ctfeGrowArray(Loc loc, TypeArray *arrayType, Expression *oldval, size_t newlen);
+
 
 
 /// Return true if t is a pointer (not a function pointer)
@@ -242,6 +277,9 @@ TypeAArray *toBuiltinAAType(Type *t);
  */
 Expression *findKeyInAA(Loc loc, AssocArrayLiteralExp *ae, Expression *e2);
 
+/// Discard the hash index of aae after its keys were removed or reordered
+void resetAAIndex(AssocArrayLiteralExp *aae);
+
 /// True if type is TypeInfo_Class
 bool isTypeInfo_Class(Type *type);
 
@@ -283,5 +321,30 @@ Expression *ctfeIndex(Loc loc, Type *type, Expression *e1, uinteger_t indx);
 /// Cast 'e' of type 'type' to type 'to'.
 Expression *ctfeCast(Loc loc, Type *type, Type *to, Expression *e);
 
+/// Evaluate >,<=, etc. on integers and floating point values. Returns 0 or 1
+int intUnsignedCmp(TOK op, d_uns64 n1, d_uns64 n2);
+int intSignedCmp(TOK op, sinteger_t n1, sinteger_t n2);
+int realCmp(TOK op, real_t r1, real_t r2);
+
+
+/***********************************************
+      CTFE bytecode VM
+***********************************************/
+
+/// Compile fd for CTFE, both for the interpreter and for the VM
+void ctfeCompile(FuncDeclaration *fd);
+
+/// Bytecode for fd, or NULL if it uses anything the VM does not support
+CtfeVmCode *ctfeVmCompile(FuncDeclaration *fd);
+
+/// Run fd on the VM. Returns NULL if it must be interpreted instead
+Expression *ctfeVmInterpret(FuncDeclaration *fd, Expressions *arguments);
+
+/// Print the CTFE statistics
+void printCtfePerformanceStats();
+
+/// Write the report for -fctfe-stats to buf
+void printCtfeProfile(OutBuffer *buf);
+
 
 #endif /* DMD_CTFE_H */
@@ -28,6 +28,7 @@
 #include "target.h"
 
 int RealEquals(real_t x1, real_t x2);
+static CtfeAAIndex *sharedAAIndex(AssocArrayLiteralExp *aae);
 
 /************** ClassReferenceExp ********************************************/
 
@@ -370,6 +371,12 @@ UnionExp copyLiteral(Expression *e)
                 return ue;
             }
             ue = Slice(se->type, se->e1, se->lwr, se->upr);
+            if (ue.exp()->op == TOKstring)
+            {
+                // Slice() has already copied the characters
+                ((StringExp *)ue.exp())->ownedByCtfe = 1;
+                return ue;
+            }
             assert(ue.exp()->op == TOKarrayliteral);
             ArrayLiteralExp *r = (ArrayLiteralExp *)ue.exp();
             r->elements = copyLiteralArray(r->elements);
@@ -458,9 +465,11 @@ UnionExp paintTypeOntoLiteralCopy(Type *type, Expression *lit)
         // TODO: we should be creating a reference to this AAExp, not
         // just a ref to the keys and values.
         int wasOwned = aae->ownedByCtfe;
+        CtfeAAIndex *index = sharedAAIndex(aae);
         new(&ue) AssocArrayLiteralExp(lit->loc, aae->keys, aae->values);
         aae = (AssocArrayLiteralExp *)ue.exp();
         aae->ownedByCtfe = wasOwned;
+        aae->ctfeIndex = index;
     }
     else
     {
@@ -1551,32 +1560,15 @@ int ctfeRawCmp(Loc loc, Expression *e1, Expression *e2)
         if (es2->keys->dim != dim)
             return 1;
 
-        bool *used = (bool *)mem.xmalloc(sizeof(bool) * dim);
-        memset(used, 0, sizeof(bool) * dim);
-
+        // The keys are unique, so each key of es1 must map to the same value in es2
         for (size_t i = 0; i < dim; ++i)
         {
             Expression *k1 = (*es1->keys)[i];
             Expression *v1 = (*es1->values)[i];
-
-            for (size_t j = 0; j < dim; ++j)
-            {
-                if (used[j])
-                    continue;
-                Expression *k2 = (*es2->keys)[j];
-                Expression *v2 = (*es2->values)[j];
-
-                if (ctfeRawCmp(loc, k1, k2))
-                    continue;
-                used[j] = true;
-                if (ctfeRawCmp(loc, v1, v2))
-                {
-                    mem.xfree(used);
-                    return 1;
-                }
-            }
+            Expression *v2 = findKeyInAA(loc, es2, k1);
+            if (!v2 || ctfeRawCmp(loc, v1, v2))
+                return 1;
         }
-        mem.xfree(used);
         return 0;
     }
     error(loc, "CTFE internal error: bad compare");
@@ -1785,26 +1777,217 @@ UnionExp ctfeCat(Type *type, Expression *e1, Expression *e2)
     return ue;
 }
 
-/*  Given an AA literal 'ae', and a key 'e2':
- *  Return ae[e2] if present, or NULL if not found.
+/*************************** CTFE associative arrays ***************************/
+
+// AA literals with fewer keys than this are searched linearly
+#define CTFE_AA_INDEX_MIN   8
+
+/* A hash index of the keys of an AA literal.  The keys and values
+ * themselves stay in the literal, in insertion order.  Keys appended
+ * to the literal are indexed when it is next searched; any other change
+ * to the keys must be followed by resetAAIndex().
  */
-Expression *findKeyInAA(Loc loc, AssocArrayLiteralExp *ae, Expression *e2)
+struct CtfeAAIndex
 {
-    /* Search the keys backwards, in case there are duplicate keys
-     */
-    for (size_t i = ae->keys->dim; i;)
+    Expressions *keys;      // the keys that are indexed
+    size_t dim;             // number of keys indexed
+    Array<hash_t> hashes;   // hash of each indexed key
+    size_t *slots;          // index + 1 of the key in each slot, 0 if empty
+    size_t nslots;          // number of slots, a power of 2
+};
+
+static hash_t combineHash(hash_t h, hash_t v)
+{
+    return h * 31 + v;
+}
+
+/* Return a hash of the CTFE value e, such that values which compare
+ * equal with ctfeEqual() have the same hash.
+ */
+static hash_t ctfeHash(Expression *e)
+{
+    switch (e->op)
+    {
+        case TOKint64:
+            return (hash_t)e->toInteger();
+
+        case TOKstring:
+        case TOKarrayliteral:
+        case TOKslice:
+        {
+            Expression *agg;
+            size_t lwr;
+            size_t len;
+            if (!getArrayBounds(e, &agg, &lwr, &len) || !agg)
+                return 0;
+
+            // Array literals hold integers normalized to their type,
+            // strings hold them unsigned.
+            Type *tn = e->type->toBasetype()->nextOf()->toBasetype();
+            dinteger_t mask = ~(dinteger_t)0;
+            if (tn->isintegral() && tn->size() < 8)
+                mask = ((dinteger_t)1 << (tn->size() * 8)) - 1;
+
+            hash_t h = 0;
+            for (size_t i = 0; i < len; i++)
+            {
+                hash_t v;
+                if (agg->op == TOKstring)
+                    v = ((StringExp *)agg)->charAt(lwr + i);
+                else
+                {
+                    Expression *el = (*((ArrayLiteralExp *)agg)->elements)[lwr + i];
+                    v = el->op == TOKint64 ? (hash_t)(el->toInteger() & mask) : ctfeHash(el);
+                }
+                h = combineHash(h, v);
+            }
+            return h;
+        }
+
+        case TOKstructliteral:
+        {
+            Expressions *elements = ((StructLiteralExp *)e)->elements;
+            hash_t h = 0;
+            for (size_t i = 0; i < elements->dim; i++)
+            {
+                Expression *el = (*elements)[i];
+                h = combineHash(h, el ? ctfeHash(el) : 0);
+            }
+            return h;
+        }
+
+        case TOKclassreference:
+            return (hash_t)((ClassReferenceExp *)e)->value;
+
+        default:
+            // Floating point, pointers, delegates: leave it to ctfeEqual()
+            return 0;
+    }
+}
+
+static void addToAAIndex(Loc loc, CtfeAAIndex *index, size_t i)
+{
+    Expression *key = (*index->keys)[i];
+    hash_t h = ctfeHash(key);
+    index->hashes.push(h);
+    size_t mask = index->nslots - 1;
+    for (size_t s = h & mask; ; s = (s + 1) & mask)
     {
-        i--;
-        Expression *ekey = (*ae->keys)[i];
-        int eq = ctfeEqual(loc, TOKequal, ekey, e2);
-        if (eq)
+        size_t j = index->slots[s];
+        // A later duplicate key hides the earlier one
+        if (!j || (index->hashes[j - 1] == h &&
+                   ctfeEqual(loc, TOKequal, (*index->keys)[j - 1], key)))
         {
-            return (*ae->values)[i];
+            index->slots[s] = i + 1;
+            break;
         }
     }
+    index->dim = i + 1;
+}
+
+/* Return the hash index of aae, which may still be empty.
+ * Literals that share their keys must share the index too.
+ */
+static CtfeAAIndex *sharedAAIndex(AssocArrayLiteralExp *aae)
+{
+    CtfeAAIndex *index = aae->ctfeIndex;
+    if (!index || index->keys != aae->keys)
+    {
+        index = new CtfeAAIndex();
+        index->keys = aae->keys;
+        index->dim = 0;
+        index->slots = NULL;
+        index->nslots = 0;
+        aae->ctfeIndex = index;
+    }
+    return index;
+}
+
+// Return the hash index of aae, bringing it up to date with its keys
+static CtfeAAIndex *getAAIndex(Loc loc, AssocArrayLiteralExp *aae)
+{
+    Expressions *keys = aae->keys;
+    CtfeAAIndex *index = sharedAAIndex(aae);
+    if (index->dim > keys->dim)
+        index->dim = 0;
+
+    // Keep the table at most half full
+    if (index->dim == 0 || keys->dim * 2 > index->nslots)
+    {
+        size_t nslots = 16;
+        while (nslots < keys->dim * 4)
+            nslots *= 2;
+        if (index->slots)
+            mem.xfree(index->slots);
+        index->slots = (size_t *)mem.xcalloc(nslots, sizeof(size_t));
+        index->nslots = nslots;
+        index->dim = 0;
+        index->hashes.setDim(0);
+    }
+    for (size_t i = index->dim; i < keys->dim; i++)
+        addToAAIndex(loc, index, i);
+    return index;
+}
+
+/* Find the key e2 in the AA literal aae.
+ * Return true and set *pindex to its position if it is present.
+ */
+static bool findKeyIndexInAA(Loc loc, AssocArrayLiteralExp *aae, Expression *e2, size_t *pindex)
+{
+    Expressions *keys = aae->keys;
+    if (keys->dim < CTFE_AA_INDEX_MIN)
+    {
+        /* Search the keys backwards, in case there are duplicate keys
+         */
+        for (size_t i = keys->dim; i;)
+        {
+            i--;
+            Expression *ekey = (*keys)[i];
+            int eq = ctfeEqual(loc, TOKequal, ekey, e2);
+            if (eq)
+            {
+                *pindex = i;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    CtfeAAIndex *index = getAAIndex(loc, aae);
+    hash_t h = ctfeHash(e2);
+    size_t mask = index->nslots - 1;
+    for (size_t s = h & mask; index->slots[s]; s = (s + 1) & mask)
+    {
+        size_t i = index->slots[s] - 1;
+        if (index->hashes[i] == h && ctfeEqual(loc, TOKequal, (*keys)[i], e2))
+        {
+            *pindex = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*  Given an AA literal 'ae', and a key 'e2':
+ *  Return ae[e2] if present, or NULL if not found.
+ */
+Expression *findKeyInAA(Loc loc, AssocArrayLiteralExp *ae, Expression *e2)
+{
+    size_t i;
+    if (findKeyIndexInAA(loc, ae, e2, &i))
+        return (*ae->values)[i];
     return NULL;
 }
 
+/* The keys of aae were changed other than by appending to them,
+ * so its hash index must be rebuilt.
+ */
+void resetAAIndex(AssocArrayLiteralExp *aae)
+{
+    if (aae->ctfeIndex)
+        aae->ctfeIndex->dim = 0;
+}
+
 /* Same as for constfold.Index, except that it only works for static arrays,
  * dynamic arrays, and strings. We know that e1 is an
  * interpreted CTFE expression, so it cannot have side-effects.
@@ -2015,27 +2198,15 @@ Expression *modifyStructField(Type *type, StructLiteralExp *se, size_t offset, E
 Expression *assignAssocArrayElement(Loc loc, AssocArrayLiteralExp *aae,
     Expression *index, Expression *newval)
 {
-    /* Create new associative array literal reflecting updated key/value
+    /* Update the value of the key in place, or append the key/value
      */
-    Expressions *keysx = aae->keys;
-    Expressions *valuesx = aae->values;
-    int updated = 0;
-    for (size_t j = valuesx->dim; j; )
-    {
-        j--;
-        Expression *ekey = (*aae->keys)[j];
-        int eq = ctfeEqual(loc, TOKequal, ekey, index);
-        if (eq)
-        {
-            (*valuesx)[j] = newval;
-            updated = 1;
-        }
-    }
-    if (!updated)
+    size_t j;
+    if (findKeyIndexInAA(loc, aae, index, &j))
+        (*aae->values)[j] = newval;
+    else
     {
-        // Append index/newval to keysx[]/valuesx[]
-        valuesx->push(newval);
-        keysx->push(index);
+        aae->values->push(newval);
+        aae->keys->push(index);
     }
     return newval;
 }
@@ -2065,15 +2236,15 @@ UnionExp changeArrayLiteralLength(Loc loc, TypeArray *arrayType,
     {
         StringExp *oldse = (StringExp *)oldval;
         void *s = mem.xcalloc(newlen + 1, oldse->sz);
-        memcpy(s, oldse->string, copylen * oldse->sz);
+        memcpy(s, (char *)oldse->string + indxlo * oldse->sz, copylen * oldse->sz);
         unsigned defaultValue = (unsigned)(defaultElem->toInteger());
         for (size_t elemi = copylen; elemi < newlen; ++elemi)
         {
             switch (oldse->sz)
             {
-                case 1:     (( utf8_t *)s)[(size_t)(indxlo + elemi)] = ( utf8_t)defaultValue;  break;
-                case 2:     ((utf16_t *)s)[(size_t)(indxlo + elemi)] = (utf16_t)defaultValue;  break;
-                case 4:     ((utf32_t *)s)[(size_t)(indxlo + elemi)] = (utf32_t)defaultValue;  break;
+                case 1:     (( utf8_t *)s)[elemi] = ( utf8_t)defaultValue;  break;
+                case 2:     ((utf16_t *)s)[elemi] = (utf16_t)defaultValue;  break;
+                case 4:     ((utf32_t *)s)[elemi] = (utf32_t)defaultValue;  break;
                 default:    assert(0);
             }
         }
@@ -2112,6 +2283,350 @@ UnionExp changeArrayLiteralLength(Loc loc, TypeArray *arrayType,
     return ue;
 }
 
+/******** CTFE append buffers ***************************/
+
+/* Arrays which are appended to in CTFE are kept in an append buffer: an
+ * array literal or string with spare capacity, which is only ever referred
+ * to through slices.  Appending to a slice which ends at the end of the
+ * used part of its buffer is done in place, so that building an array one
+ * element at a time takes amortized constant time per element.  Any other
+ * append first copies the slice into a new buffer, just like the runtime.
+ * Arrays of 1, 2 or 4 byte integers are stored natively, in a string.
+ */
+
+bool isCtfeNativeElement(Type *t)
+{
+    Type *tb = t->toBasetype();
+    if (!tb->isintegral())
+        return false;
+    d_uns64 sz = tb->size();
+    return sz == 1 || sz == 2 || sz == 4;
+}
+
+bool isCtfeNativeArray(Expression *e)
+{
+    Expression *agg = (e->op == TOKslice) ? ((SliceExp *)e)->e1 : e;
+    if (agg->op != TOKstring || ((StringExp *)agg)->ownedByCtfe != 1)
+        return false;
+    Type *tb = e->type->toBasetype();
+    if (tb->ty != Tarray && tb->ty != Tsarray)
+        return false;
+    Type *tn = tb->nextOf()->toBasetype();
+    return tn->ty != Tchar && tn->ty != Twchar && tn->ty != Tdchar;
+}
+
+ArrayLiteralExp *nativeArrayToLiteral(StringExp *se)
+{
+    Type *elemType = se->type->toBasetype()->nextOf();
+    Expressions *elements = new Expressions();
+    elements->setDim(se->len);
+    for (size_t i = 0; i < se->len; i++)
+        (*elements)[i] = new IntegerExp(se->loc, se->charAt(i), elemType);
+    ArrayLiteralExp *ae = new ArrayLiteralExp(se->loc, elements);
+    ae->type = se->type;
+    return ae;
+}
+
+/* Find the literal that the array e is a slice of,
+ * and the bounds of the slice.  The literal is NULL for a null array.
+ * Return false if e is not an interpreted array.
+ */
+bool getArrayBounds(Expression *e, Expression **pagg, size_t *plwr, size_t *plen)
+{
+    *pagg = NULL;
+    *plwr = 0;
+    *plen = 0;
+    if (e->op == TOKnull)
+        return true;
+    if (e->op == TOKslice)
+    {
+        SliceExp *se = (SliceExp *)e;
+        if (se->e1->op == TOKnull)
+            return true;
+        if ((se->e1->op != TOKstring && se->e1->op != TOKarrayliteral) ||
+            !se->lwr || se->lwr->op != TOKint64 ||
+            !se->upr || se->upr->op != TOKint64)
+            return false;
+        *pagg = se->e1;
+        *plwr = (size_t)se->lwr->toInteger();
+        *plen = (size_t)(se->upr->toInteger() - se->lwr->toInteger());
+        return true;
+    }
+    if (e->op == TOKstring || e->op == TOKarrayliteral)
+    {
+        *pagg = e;
+        *plen = (size_t)resolveArrayLength(e);
+        return true;
+    }
+    return false;
+}
+
+// Return true if elements [lwr .. lwr + len] of ae are all integers
+static bool isIntegerArrayLiteral(ArrayLiteralExp *ae, size_t lwr, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        if ((*ae->elements)[lwr + i]->op != TOKint64)
+            return false;
+    }
+    return true;
+}
+
+static void setStringElement(StringExp *se, size_t i, dinteger_t value)
+{
+    void *s = se->string;
+    switch (se->sz)
+    {
+        case 1:     (( utf8_t *)s)[i] = ( utf8_t)value; break;
+        case 2:     ((utf16_t *)s)[i] = (utf16_t)value; break;
+        case 4:     ((utf32_t *)s)[i] = (utf32_t)value; break;
+        default:    assert(0);                          break;
+    }
+}
+
+/* Make room for 'nadd' elements after the end of the array oldval of type
+ * 'type', in place if possible.  Return the append buffer, with *plwr set
+ * to the start of oldval in it and *pstart to the first new element, which
+ * the caller must set.  Return NULL if oldval cannot be put in a buffer.
+ */
+static Expression *reserveAppend(Loc loc, Type *type, Expression *oldval,
+    size_t nadd, size_t *plwr, size_t *pstart)
+{
+    Type *elemType = type->toBasetype()->nextOf();
+    bool native = isCtfeNativeElement(elemType);
+    unsigned char sz = native ? (unsigned char)elemType->toBasetype()->size() : 0;
+
+    Expression *agg;
+    size_t lwr;
+    size_t len;
+    if (!getArrayBounds(oldval, &agg, &lwr, &len))
+        return NULL;
+
+    if (agg && oldval->op == TOKslice)
+    {
+        if (agg->op == TOKstring && native)
+        {
+            StringExp *se = (StringExp *)agg;
+            if (se->ctfeCapacity && se->ownedByCtfe == 1 && se->sz == sz &&
+                lwr + len == se->len)
+            {
+                if (se->len + nadd > se->ctfeCapacity)
+                {
+                    size_t capacity = (se->len + nadd) * 2;
+                    se->string = mem.xrealloc(se->string, (capacity + 1) * sz);
+                    se->ctfeCapacity = capacity;
+                }
+                *plwr = lwr;
+                *pstart = se->len;
+                se->len += nadd;
+                memset((char *)se->string + se->len * sz, 0, sz);
+                return se;
+            }
+        }
+        if (agg->op == TOKarrayliteral && !native)
+        {
+            ArrayLiteralExp *ae = (ArrayLiteralExp *)agg;
+            size_t dim = ae->elements->dim;
+            if (ae->ctfeCapacity && ae->ownedByCtfe == 1 && lwr + len == dim)
+            {
+                if (dim + nadd > ae->ctfeCapacity)
+                {
+                    size_t capacity = (dim + nadd) * 2;
+                    ae->elements->reserve(capacity - dim);
+                    ae->ctfeCapacity = capacity;
+                }
+                ae->elements->setDim(dim + nadd);
+                *plwr = lwr;
+                *pstart = dim;
+                return ae;
+            }
+        }
+    }
+
+    // Copy oldval into a new buffer
+    size_t capacity = (len + nadd) * 2;
+    if (capacity < 16)
+        capacity = 16;
+    if (native)
+    {
+        if (agg && agg->op == TOKstring && ((StringExp *)agg)->sz != sz)
+            return NULL;
+        if (agg && agg->op == TOKarrayliteral &&
+            !isIntegerArrayLiteral((ArrayLiteralExp *)agg, lwr, len))
+            return NULL;
+
+        CtfeStatus::numArrayAllocs++;
+        void *s = mem.xcalloc(capacity + 1, sz);
+        StringExp *se = new StringExp(loc, s, len + nadd);
+        se->type = type;
+        se->sz = sz;
+        se->committed = 1;
+        se->ownedByCtfe = 1;
+        se->ctfeCapacity = capacity;
+        if (agg && agg->op == TOKstring)
+            memcpy(s, (char *)((StringExp *)agg)->string + lwr * sz, len * sz);
+        else if (agg)
+        {
+            ArrayLiteralExp *ae = (ArrayLiteralExp *)agg;
+            for (size_t i = 0; i < len; i++)
+                setStringElement(se, i, (*ae->elements)[lwr + i]->toInteger());
+        }
+        *plwr = 0;
+        *pstart = len;
+        return se;
+    }
+    if (agg && agg->op != TOKarrayliteral)
+        return NULL;
+
+    CtfeStatus::numArrayAllocs++;
+    Expressions *elements = new Expressions();
+    elements->reserve(capacity);
+    elements->setDim(len + nadd);
+    for (size_t i = 0; i < len; i++)
+        (*elements)[i] = copyLiteral((*((ArrayLiteralExp *)agg)->elements)[lwr + i]).copy();
+    ArrayLiteralExp *ae = new ArrayLiteralExp(loc, elements);
+    ae->type = type;
+    ae->ownedByCtfe = 1;
+    ae->ctfeCapacity = capacity;
+    *plwr = 0;
+    *pstart = len;
+    return ae;
+}
+
+// Return a slice of the append buffer 'buf'
+static Expression *bufferSlice(Loc loc, Type *type, Expression *buf, size_t lwr, size_t upr)
+{
+    SliceExp *se = new SliceExp(loc, buf,
+        new IntegerExp(loc, lwr, Type::tsize_t), new IntegerExp(loc, upr, Type::tsize_t));
+    se->type = type;
+    return se;
+}
+
+Expression *ctfeAppend(Loc loc, Type *type, Expression *oldval, Expression *newval, bool isElement)
+{
+    Type *elemType = type->toBasetype()->nextOf();
+    if (!elemType || elemType->toBasetype()->ty == Tvoid)
+        return NULL;
+    bool native = isCtfeNativeElement(elemType);
+    Type *tn = elemType->toBasetype();
+
+    // Work out how many elements are appended
+    Expression *nagg = NULL;
+    size_t nlwr = 0;
+    size_t nadd = 1;
+    bool encode = false;
+    if (isElement)
+    {
+        if (native)
+        {
+            if (newval->op != TOKint64)
+                return NULL;
+            // char[] ~= dchar appends the UTF encoding of the character
+            if ((tn->ty == Tchar || tn->ty == Twchar) &&
+                newval->type->toBasetype()->size() != tn->size())
+            {
+                nadd = utf_codeLength((int)tn->size(), (dchar_t)newval->toInteger());
+                encode = true;
+            }
+        }
+    }
+    else
+    {
+        if (!getArrayBounds(newval, &nagg, &nlwr, &nadd))
+            return NULL;
+        if (nagg && native)
+        {
+            if (nagg->op == TOKstring && ((StringExp *)nagg)->sz != tn->size())
+                return NULL;
+            if (nagg->op == TOKarrayliteral &&
+                !isIntegerArrayLiteral((ArrayLiteralExp *)nagg, nlwr, nadd))
+                return NULL;
+        }
+        if (nagg && !native && nagg->op != TOKarrayliteral)
+            return NULL;
+    }
+
+    size_t lwr;
+    size_t start;
+    Expression *buf = reserveAppend(loc, type, oldval, nadd, &lwr, &start);
+    if (!buf)
+        return NULL;
+
+    if (native)
+    {
+        StringExp *se = (StringExp *)buf;
+        if (encode)
+            utf_encode(se->sz, (char *)se->string + start * se->sz, (dchar_t)newval->toInteger());
+        else if (isElement)
+            setStringElement(se, start, newval->toInteger());
+        else if (nagg && nagg->op == TOKstring)
+        {
+            StringExp *nse = (StringExp *)nagg;
+            memmove((char *)se->string + start * se->sz,
+                    (char *)nse->string + nlwr * se->sz, nadd * se->sz);
+        }
+        else if (nagg)
+        {
+            ArrayLiteralExp *nae = (ArrayLiteralExp *)nagg;
+            for (size_t i = 0; i < nadd; i++)
+                setStringElement(se, start + i, (*nae->elements)[nlwr + i]->toInteger());
+        }
+    }
+    else
+    {
+        ArrayLiteralExp *ae = (ArrayLiteralExp *)buf;
+        if (isElement)
+            (*ae->elements)[start] = newval;
+        else
+        {
+            for (size_t i = 0; i < nadd; i++)
+            {
+                Expression *el = (*((ArrayLiteralExp *)nagg)->elements)[nlwr + i];
+                (*ae->elements)[start + i] = copyLiteral(el).copy();
+            }
+        }
+    }
+    return bufferSlice(loc, type, buf, lwr, start + nadd);
+}
+
+Expression *ctfeGrowArray(Loc loc, TypeArray *arrayType, Expression *oldval, size_t newlen)
+{
+    Expression *agg;
+    size_t lwr;
+    size_t len;
+    if (!getArrayBounds(oldval, &agg, &lwr, &len) || newlen <= len)
+        return NULL;
+
+    Type *elemType = arrayType->next;
+    Expression *defaultElem = elemType->defaultInitLiteral(loc);
+    bool native = isCtfeNativeElement(elemType);
+    if (native && defaultElem->op != TOKint64)
+        return NULL;
+
+    size_t start;
+    Expression *buf = reserveAppend(loc, arrayType, oldval, newlen - len, &lwr, &start);
+    if (!buf)
+        return NULL;
+
+    if (native)
+    {
+        dinteger_t value = defaultElem->toInteger();
+        for (size_t i = start; i < lwr + newlen; i++)
+            setStringElement((StringExp *)buf, i, value);
+    }
+    else
+    {
+        /* If it is an aggregate literal representing a value type,
+         * we need to create a unique copy for each element
+         */
+        bool mustCopy = elemType->ty == Tstruct || elemType->ty == Tsarray;
+        Expressions *elements = ((ArrayLiteralExp *)buf)->elements;
+        for (size_t i = start; i < lwr + newlen; i++)
+            (*elements)[i] = mustCopy ? copyLiteral(defaultElem).copy() : defaultElem;
+    }
+    return bufferSlice(loc, arrayType, buf, lwr, lwr + newlen);
+}
+
 /*************************** CTFE Sanity Checks ***************************/
 
 bool isCtfeValueValid(Expression *newval)
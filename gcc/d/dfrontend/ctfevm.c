@@ -0,0 +1,1956 @@
+/* Compiler implementation of the D programming language
+ * Copyright (c) 1999-2014 by Digital Mars
+ * All Rights Reserved
+ * written by Walter Bright
+ * http://www.digitalmars.com
+ * Distributed under the Boost Software License, Version 1.0.
+ * http://www.boost.org/LICENSE_1_0.txt
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>                     // mem{cpy|set}()
+
+#include "rmem.h"
+#include "port.h"
+
+#include "statement.h"
+#include "expression.h"
+#include "declaration.h"
+#include "init.h"
+#include "mtype.h"
+#include "id.h"
+#include "ctfe.h"
+
+#define LOG     0
+
+bool walkPostorder(Expression *e, StoppableVisitor *v);
+
+/* Bytecode VM for CTFE.
+ *
+ * Functions which only compute with integers, floating point values and
+ * read-only arrays are compiled into a register bytecode the first time
+ * they are interpreted.  Every local variable and temporary has its own
+ * register holding a native value; the parameters occupy the first
+ * registers of the frame.
+ *
+ * Arithmetic mirrors constfold.c.  Whenever the VM cannot compute exactly
+ * what the AST interpreter would (division by zero, out of range shifts
+ * and indices, failed asserts, non-literal array elements, ...) it gives
+ * up and the call is interpreted again from the AST, which then issues
+ * the diagnostic.  This is safe because compiled functions can only write
+ * to their own registers.
+ */
+
+enum CtfeVmKind
+{
+    VMnone,         // not supported by the VM
+    VMint,          // integral, boolean and character types
+    VMreal,         // float, double and real
+    VMarray,        // read-only view of an array of VMint or VMreal
+    VMvoid
+};
+
+enum CtfeVmOp
+{
+    VMOPmov,        // a = b
+    VMOPconst,      // a = consts[b]
+
+    VMOPadd,        // a = cast(ty)(b op c)
+    VMOPmin,
+    VMOPmul,
+    VMOPdiv,
+    VMOPmod,
+    VMOPand,
+    VMOPor,
+    VMOPxor,
+    VMOPshl,        // a = cast(ty)(b op c), d is the bit size of b
+    VMOPshr,
+    VMOPushr,
+    VMOPneg,        // a = cast(ty)(op b)
+    VMOPcom,
+    VMOPnot,
+    VMOPcmp,        // a = b op c, op is the TOK in d
+
+    VMOPradd,       // a = b op c
+    VMOPrmin,
+    VMOPrmul,
+    VMOPrdiv,
+    VMOPrneg,
+    VMOPrcmp,       // a = b op c, op is the TOK in d
+    VMOPrbool,      // a = b != 0
+
+    VMOPcast,       // a = cast(ty)b
+    VMOPitor,       // a = cast(real)b
+    VMOPrtoi,       // a = cast(ty)b
+
+    VMOPlen,        // a = b.length
+    VMOPindex,      // a = b[c]
+    VMOPslice,      // a = b[c .. d]
+    VMOParreq,      // a = (b == c), d is the TOK
+
+    VMOPjmp,        // goto a
+    VMOPjz,         // if (!a) goto b
+    VMOPjnz,        // if (a) goto b
+
+    VMOPcall,       // a = callees[b](c[0 .. d])
+    VMOPret,        // return a
+    VMOPretvoid,
+    VMOPassert,     // if (!a) give up
+    VMOPbail        // give up
+};
+
+enum
+{
+    VMFLAGunsigned = 1,     // integer operands compare or divide as unsigned
+    VMFLAGmodcheck = 2,     // check for int.min % -1
+    VMFLAGreal = 4          // array elements are VMreal
+};
+
+enum CtfeVmStatus
+{
+    VMreturn,       // the function returned
+    VMbail,         // hand this call back to the AST interpreter
+    VMunsupported   // ditto, and never try this function again
+};
+
+struct CtfeVmArray
+{
+    Expression *agg;        // StringExp or ArrayLiteralExp, NULL if empty
+    size_t lwr;
+    size_t length;
+};
+
+union CtfeVmValue
+{
+    dinteger_t i;
+    real_t r;
+    CtfeVmArray a;
+};
+
+struct CtfeVmInsn
+{
+    unsigned char op;
+    unsigned char ty;       // type of the result
+    unsigned char ty2;      // type of the operands, or of the array elements
+    unsigned char flags;
+    int a, b, c, d;
+};
+
+struct CtfeVmCode
+{
+    FuncDeclaration *func;
+    Array<CtfeVmInsn> code;
+    Array<CtfeVmValue> consts;
+    FuncDeclarations callees;
+    size_t nparams;
+    size_t nregs;
+    CtfeVmKind retkind;
+    bool memoize;           // strongly pure with integer parameters only
+};
+
+/* Registers of all active VM frames.
+ */
+static Array<CtfeVmValue> vmstack;
+
+/* Calls made by the VM do not go through interpret(), so the VM keeps
+ * its own memo cache of strongly pure calls.  As there, each slot holds
+ * a single call that is replaced by any other call with the same index.
+ */
+#define VM_MEMO_SIZE        4096
+#define VM_MEMO_MAXARGS     4
+
+struct CtfeVmMemoEntry
+{
+    CtfeVmCode *code;
+    dinteger_t args[VM_MEMO_MAXARGS];
+    CtfeVmValue ret;
+};
+
+static CtfeVmMemoEntry vmMemo[VM_MEMO_SIZE];
+
+static CtfeVmMemoEntry *vmMemoSlot(CtfeVmCode *code, CtfeVmValue *args)
+{
+    hash_t h = (hash_t)code;
+    for (size_t i = 0; i < code->nparams; i++)
+        h = h * 31 + (hash_t)args[i].i;
+    return &vmMemo[h % VM_MEMO_SIZE];
+}
+
+static bool vmMemoMatch(CtfeVmMemoEntry *entry, CtfeVmCode *code, CtfeVmValue *args)
+{
+    if (entry->code != code)
+        return false;
+    for (size_t i = 0; i < code->nparams; i++)
+    {
+        if (entry->args[i] != args[i].i)
+            return false;
+    }
+    return true;
+}
+
+static CtfeVmKind vmKind(Type *t)
+{
+    if (!t)
+        return VMnone;
+    Type *tb = t->toBasetype();
+    switch (tb->ty)
+    {
+        case Tbool:
+        case Tint8:     case Tuns8:
+        case Tint16:    case Tuns16:
+        case Tint32:    case Tuns32:
+        case Tint64:    case Tuns64:
+        case Tchar:     case Twchar:    case Tdchar:
+            return VMint;
+
+        case Tfloat32:
+        case Tfloat64:
+        case Tfloat80:
+            return VMreal;
+
+        case Tarray:
+        case Tsarray:
+        {
+            CtfeVmKind k = vmKind(tb->nextOf());
+            return (k == VMint || k == VMreal) ? VMarray : VMnone;
+        }
+
+        case Tvoid:
+            return VMvoid;
+
+        default:
+            return VMnone;
+    }
+}
+
+/* Same as IntegerExp::normalize()
+ */
+static dinteger_t vmNormalize(int ty, dinteger_t value)
+{
+    switch (ty)
+    {
+        case Tbool:     return (value != 0);
+        case Tint8:     return (d_int8)  value;
+        case Tchar:
+        case Tuns8:     return (d_uns8)  value;
+        case Tint16:    return (d_int16) value;
+        case Twchar:
+        case Tuns16:    return (d_uns16) value;
+        case Tint32:    return (d_int32) value;
+        case Tdchar:
+        case Tuns32:    return (d_uns32) value;
+        case Tint64:    return (d_int64) value;
+        default:        return value;
+    }
+}
+
+static bool vmIsSigned(int ty)
+{
+    return ty == Tint8 || ty == Tint16 || ty == Tint32 || ty == Tint64;
+}
+
+/* Make a VM array from the CTFE value e.
+ * Returns false if e is not a literal the VM can read.
+ */
+static bool vmArrayOf(Expression *e, CtfeVmArray *a)
+{
+    a->agg = NULL;
+    a->lwr = 0;
+    a->length = 0;
+
+    dinteger_t lwr = 0;
+    dinteger_t upr = 0;
+    bool sliced = false;
+    if (e->op == TOKslice)
+    {
+        SliceExp *se = (SliceExp *)e;
+        if (!se->lwr || !se->upr || se->lwr->op != TOKint64 || se->upr->op != TOKint64)
+            return false;
+        lwr = se->lwr->toInteger();
+        upr = se->upr->toInteger();
+        sliced = true;
+        e = se->e1;
+    }
+
+    dinteger_t len;
+    if (e->op == TOKnull)
+        len = 0;
+    else if (e->op == TOKstring)
+        len = ((StringExp *)e)->len;
+    else if (e->op == TOKarrayliteral)
+        len = ((ArrayLiteralExp *)e)->elements->dim;
+    else
+        return false;
+
+    if (!sliced)
+        upr = len;
+    if (lwr > upr || upr > len)
+        return false;
+    if (e->op != TOKnull)
+        a->agg = e;
+    a->lwr = (size_t)lwr;
+    a->length = (size_t)(upr - lwr);
+    return true;
+}
+
+/* Read element i of the array a into v.
+ * Returns false if the element is not a literal.
+ */
+static bool vmReadElement(CtfeVmArray *a, size_t i, int ty, bool isreal, CtfeVmValue *v)
+{
+    if (a->agg->op == TOKstring)
+    {
+        if (isreal)
+            return false;
+        v->i = vmNormalize(ty, ((StringExp *)a->agg)->charAt(a->lwr + i));
+        return true;
+    }
+
+    Expression *e = (*((ArrayLiteralExp *)a->agg)->elements)[a->lwr + i];
+    if (isreal)
+    {
+        if (!e || e->op != TOKfloat64)
+            return false;
+        v->r = e->toReal();
+    }
+    else
+    {
+        if (!e || e->op != TOKint64)
+            return false;
+        v->i = vmNormalize(ty, e->toInteger());
+    }
+    return true;
+}
+
+/* Return true if e is a literal that can be loaded as a VM constant.
+ */
+static bool isVmLiteral(Expression *e)
+{
+    switch (e->op)
+    {
+        case TOKint64:
+            return vmKind(e->type) == VMint;
+
+        case TOKfloat64:
+            return vmKind(e->type) == VMreal;
+
+        case TOKnull:
+        case TOKstring:
+            return vmKind(e->type) == VMarray;
+
+        case TOKarrayliteral:
+        {
+            if (vmKind(e->type) != VMarray)
+                return false;
+            Expressions *elements = ((ArrayLiteralExp *)e)->elements;
+            for (size_t i = 0; i < elements->dim; i++)
+            {
+                Expression *el = (*elements)[i];
+                if (!el || (el->op != TOKint64 && el->op != TOKfloat64))
+                    return false;
+            }
+            return true;
+        }
+
+        default:
+            return false;
+    }
+}
+
+/* Return true if evaluating e may assign to a local variable.
+ */
+static bool writesLocals(Expression *e)
+{
+    class WritesLocals : public StoppableVisitor
+    {
+    public:
+        void visit(Expression *e)
+        {
+            switch (e->op)
+            {
+                case TOKdeclaration:
+                case TOKassign:     case TOKconstruct:  case TOKblit:
+                case TOKaddass:     case TOKminass:     case TOKmulass:
+                case TOKdivass:     case TOKmodass:     case TOKpowass:
+                case TOKshlass:     case TOKshrass:     case TOKushrass:
+                case TOKandass:     case TOKorass:      case TOKxorass:
+                case TOKcatass:
+                case TOKplusplus:   case TOKminusminus:
+                case TOKpreplusplus: case TOKpreminusminus:
+                    stop = true;
+                    break;
+
+                default:
+                    break;
+            }
+        }
+    };
+
+    WritesLocals v;
+    return walkPostorder(e, &v);
+}
+
+/* A statement that break and continue can jump out of.
+ */
+struct CtfeVmTarget
+{
+    bool isloop;                // false for a switch
+    Array<size_t> breaks;       // jumps to the end of the statement
+    Array<size_t> continues;    // jumps to the next iteration
+};
+
+class CtfeVmCompiler : public Visitor
+{
+public:
+    CtfeVmCode *code;
+    bool failed;
+    int result;                 // register with the value of the expression, -1 if void
+
+    VarDeclarations vars;       // variables with a register
+    Array<int> varregs;
+    Array<CtfeVmTarget *> targets;
+    Statements labels;          // case and default statements already compiled
+    Array<size_t> labelpos;
+    Statements gotos;           // jumps to case and default statements
+    Array<size_t> gotoinsns;
+
+    CtfeVmCompiler(CtfeVmCode *code)
+        : code(code)
+    {
+        failed = false;
+        result = -1;
+    }
+
+    size_t emit(int op, int ty, int a, int b = 0, int c = 0, int d = 0, int flags = 0, int ty2 = 0)
+    {
+        CtfeVmInsn insn;
+        insn.op = (unsigned char)op;
+        insn.ty = (unsigned char)ty;
+        insn.ty2 = (unsigned char)ty2;
+        insn.flags = (unsigned char)flags;
+        insn.a = a;
+        insn.b = b;
+        insn.c = c;
+        insn.d = d;
+        code->code.push(insn);
+        return code->code.dim - 1;
+    }
+
+    // Point the jump instruction at i to target.
+    void patch(size_t i, size_t target)
+    {
+        CtfeVmInsn *insn = &code->code[i];
+        if (insn->op == VMOPjmp)
+            insn->a = (int)target;
+        else
+            insn->b = (int)target;
+    }
+
+    void patchAll(Array<size_t> *jumps, size_t target)
+    {
+        for (size_t i = 0; i < jumps->dim; i++)
+            patch((*jumps)[i], target);
+    }
+
+    int newReg()
+    {
+        return (int)code->nregs++;
+    }
+
+    int newVar(VarDeclaration *v)
+    {
+        int r = newReg();
+        vars.push(v);
+        varregs.push(r);
+        return r;
+    }
+
+    int findVar(VarDeclaration *v)
+    {
+        for (size_t i = vars.dim; i-- > 0; )
+        {
+            if (vars[i] == v)
+                return varregs[i];
+        }
+        return -1;
+    }
+
+    bool isVarReg(int r)
+    {
+        for (size_t i = 0; i < varregs.dim; i++)
+        {
+            if (varregs[i] == r)
+                return true;
+        }
+        return false;
+    }
+
+    int constant(CtfeVmValue v)
+    {
+        code->consts.push(v);
+        int r = newReg();
+        emit(VMOPconst, 0, r, (int)code->consts.dim - 1);
+        return r;
+    }
+
+    int fail()
+    {
+        failed = true;
+        result = -1;
+        return 0;
+    }
+
+    // Compile e, and return the register holding its value.
+    int value(Expression *e)
+    {
+        if (failed)
+            return 0;
+        result = -1;
+        e->accept(this);
+        if (failed)
+            return 0;
+        if (result < 0)
+            return fail();
+        return result;
+    }
+
+    // Compile e, and snapshot its value if it lives in a variable
+    // that evaluating later could overwrite.
+    int operand(Expression *e, Expression *later)
+    {
+        int r = value(e);
+        if (!failed && later && isVarReg(r) && writesLocals(later))
+        {
+            int t = newReg();
+            emit(VMOPmov, 0, t, r);
+            r = t;
+        }
+        return r;
+    }
+
+    // Compile e for its side effects only.
+    void discard(Expression *e)
+    {
+        if (failed)
+            return;
+        result = -1;
+        e->accept(this);
+        result = -1;
+    }
+
+    // Compile e as the condition of a branch.
+    int condition(Expression *e)
+    {
+        CtfeVmKind k = vmKind(e->type);
+        int r = value(e);
+        if (k == VMreal)
+        {
+            int t = newReg();
+            emit(VMOPrbool, Tbool, t, r);
+            return t;
+        }
+        if (k != VMint)
+            return fail();
+        return r;
+    }
+
+    // Convert the value in register r of type from to type to.
+    int convert(int r, Type *from, Type *to)
+    {
+        CtfeVmKind kf = vmKind(from);
+        CtfeVmKind kt = vmKind(to);
+        Type *tf = from->toBasetype();
+        Type *tt = to->toBasetype();
+        if (kf == VMint && kt == VMint)
+        {
+            if (tf->ty == tt->ty)
+                return r;
+            int t = newReg();
+            emit(VMOPcast, tt->ty, t, r);
+            return t;
+        }
+        if (kf == VMint && kt == VMreal)
+        {
+            int t = newReg();
+            emit(VMOPitor, tt->ty, t, r, 0, 0, tf->ty == Tuns64 ? VMFLAGunsigned : 0);
+            return t;
+        }
+        if (kf == VMreal && kt == VMint)
+        {
+            int t = newReg();
+            emit(VMOPrtoi, tt->ty, t, r);
+            return t;
+        }
+        if (kf == VMreal && kt == VMreal)
+            return r;
+        if (kf == VMarray && kt == VMarray)
+        {
+            Type *ef = tf->nextOf()->toBasetype();
+            Type *et = tt->nextOf()->toBasetype();
+            if (ef->ty == et->ty)
+                return r;
+        }
+        return fail();
+    }
+
+    // Return the local variable that e refers to, or NULL.
+    VarDeclaration *localVar(Expression *e, int *preg)
+    {
+        if (e->op != TOKvar)
+            return NULL;
+        VarDeclaration *v = ((VarExp *)e)->var->isVarDeclaration();
+        if (!v)
+            return NULL;
+        *preg = findVar(v);
+        return *preg >= 0 ? v : NULL;
+    }
+
+    // Declare the `$` variable of an index or slice of the array in r.
+    void lengthVar(VarDeclaration *v, int r)
+    {
+        if (!v)
+            return;
+        int lr = newVar(v);
+        emit(VMOPlen, v->type->toBasetype()->ty, lr, r);
+    }
+
+    /* ------------------------ Statements ------------------------ */
+
+    void visit(Statement *s)
+    {
+    #if LOG
+        printf("%s CtfeVm: cannot compile %s\n", s->loc.toChars(), s->toChars());
+    #endif
+        fail();
+    }
+
+    void visit(ExpStatement *s)
+    {
+        if (s->exp)
+            discard(s->exp);
+    }
+
+    void visit(DtorExpStatement *s)
+    {
+        fail();
+    }
+
+    void visit(CompoundStatement *s)
+    {
+        for (size_t i = 0; i < s->statements->dim && !failed; i++)
+        {
+            Statement *sx = (*s->statements)[i];
+            if (sx)
+                sx->accept(this);
+        }
+    }
+
+    void visit(CompoundAsmStatement *s)
+    {
+        fail();
+    }
+
+    void visit(ScopeStatement *s)
+    {
+        if (s->statement)
+            s->statement->accept(this);
+    }
+
+    void visit(IfStatement *s)
+    {
+        int r = condition(s->condition);
+        if (failed)
+            return;
+        size_t jelse = emit(VMOPjz, 0, r, -1);
+        if (s->ifbody)
+            s->ifbody->accept(this);
+        if (s->elsebody)
+        {
+            size_t jend = emit(VMOPjmp, 0, -1);
+            patch(jelse, code->code.dim);
+            s->elsebody->accept(this);
+            patch(jend, code->code.dim);
+        }
+        else
+            patch(jelse, code->code.dim);
+    }
+
+    void visit(ForStatement *s)
+    {
+        if (s->init)
+            s->init->accept(this);
+        if (failed)
+            return;
+
+        CtfeVmTarget target;
+        target.isloop = true;
+        targets.push(&target);
+
+        size_t start = code->code.dim;
+        if (s->condition)
+        {
+            int r = condition(s->condition);
+            if (failed)
+                return;
+            target.breaks.push(emit(VMOPjz, 0, r, -1));
+        }
+        if (s->body)
+            s->body->accept(this);
+        patchAll(&target.continues, code->code.dim);
+        if (s->increment)
+            discard(s->increment);
+        emit(VMOPjmp, 0, (int)start);
+        patchAll(&target.breaks, code->code.dim);
+
+        targets.pop();
+    }
+
+    void visit(DoStatement *s)
+    {
+        CtfeVmTarget target;
+        target.isloop = true;
+        targets.push(&target);
+
+        size_t start = code->code.dim;
+        if (s->body)
+            s->body->accept(this);
+        patchAll(&target.continues, code->code.dim);
+        int r = condition(s->condition);
+        if (failed)
+            return;
+        emit(VMOPjnz, 0, r, (int)start);
+        patchAll(&target.breaks, code->code.dim);
+
+        targets.pop();
+    }
+
+    void visit(SwitchStatement *s)
+    {
+        if (vmKind(s->condition->type) != VMint)
+        {
+            fail();
+            return;
+        }
+        int ty = s->condition->type->toBasetype()->ty;
+        int r = value(s->condition);
+        if (failed)
+            return;
+
+        // Compare against each case in turn, like the AST interpreter.
+        size_t dim = s->cases ? s->cases->dim : 0;
+        for (size_t i = 0; i < dim; i++)
+        {
+            CaseStatement *cs = (*s->cases)[i];
+            if (cs->exp->op != TOKint64)
+            {
+                fail();
+                return;
+            }
+            CtfeVmValue v;
+            v.i = vmNormalize(ty, cs->exp->toInteger());
+            int rc = constant(v);
+            int t = newReg();
+            emit(VMOPcmp, Tbool, t, r, rc, TOKequal);
+            gotos.push(cs);
+            gotoinsns.push(emit(VMOPjnz, 0, t, -1));
+        }
+        if (s->hasNoDefault || !s->sdefault)
+            emit(VMOPbail, 0, 0);
+        else
+        {
+            gotos.push(s->sdefault);
+            gotoinsns.push(emit(VMOPjmp, 0, -1));
+        }
+
+        CtfeVmTarget target;
+        target.isloop = false;
+        targets.push(&target);
+        if (s->body)
+            s->body->accept(this);
+        patchAll(&target.breaks, code->code.dim);
+        targets.pop();
+    }
+
+    void visit(CaseStatement *s)
+    {
+        labels.push(s);
+        labelpos.push(code->code.dim);
+        if (s->statement)
+            s->statement->accept(this);
+    }
+
+    void visit(DefaultStatement *s)
+    {
+        labels.push(s);
+        labelpos.push(code->code.dim);
+        if (s->statement)
+            s->statement->accept(this);
+    }
+
+    void visit(GotoCaseStatement *s)
+    {
+        if (!s->cs)
+        {
+            fail();
+            return;
+        }
+        gotos.push(s->cs);
+        gotoinsns.push(emit(VMOPjmp, 0, -1));
+    }
+
+    void visit(GotoDefaultStatement *s)
+    {
+        if (!s->sw || !s->sw->sdefault)
+        {
+            fail();
+            return;
+        }
+        gotos.push(s->sw->sdefault);
+        gotoinsns.push(emit(VMOPjmp, 0, -1));
+    }
+
+    void visit(SwitchErrorStatement *s)
+    {
+        emit(VMOPbail, 0, 0);
+    }
+
+    void visit(BreakStatement *s)
+    {
+        if (s->ident || !targets.dim)
+        {
+            fail();
+            return;
+        }
+        targets[targets.dim - 1]->breaks.push(emit(VMOPjmp, 0, -1));
+    }
+
+    void visit(ContinueStatement *s)
+    {
+        if (s->ident)
+        {
+            fail();
+            return;
+        }
+        for (size_t i = targets.dim; i-- > 0; )
+        {
+            if (targets[i]->isloop)
+            {
+                targets[i]->continues.push(emit(VMOPjmp, 0, -1));
+                return;
+            }
+        }
+        fail();
+    }
+
+    void visit(ReturnStatement *s)
+    {
+        if (code->retkind == VMvoid)
+        {
+            if (s->exp)
+                discard(s->exp);
+            emit(VMOPretvoid, 0, 0);
+            return;
+        }
+        if (!s->exp)
+        {
+            fail();
+            return;
+        }
+        TypeFunction *tf = (TypeFunction *)code->func->type->toBasetype();
+        if (vmKind(s->exp->type) != code->retkind)
+        {
+            fail();
+            return;
+        }
+        int r = value(s->exp);
+        if (failed)
+            return;
+        r = convert(r, s->exp->type, tf->next);
+        emit(VMOPret, 0, r);
+    }
+
+    /* ------------------------ Expressions ------------------------ */
+
+    void visit(Expression *e)
+    {
+    #if LOG
+        printf("%s CtfeVm: cannot compile %s\n", e->loc.toChars(), e->toChars());
+    #endif
+        fail();
+    }
+
+    void visit(IntegerExp *e)
+    {
+        if (!isVmLiteral(e))
+        {
+            fail();
+            return;
+        }
+        CtfeVmValue v;
+        v.i = e->toInteger();
+        result = constant(v);
+    }
+
+    void visit(RealExp *e)
+    {
+        if (!isVmLiteral(e))
+        {
+            fail();
+            return;
+        }
+        CtfeVmValue v;
+        v.r = e->toReal();
+        result = constant(v);
+    }
+
+    void visit(NullExp *e)
+    {
+        literal(e);
+    }
+
+    void visit(StringExp *e)
+    {
+        literal(e);
+    }
+
+    void visit(ArrayLiteralExp *e)
+    {
+        literal(e);
+    }
+
+    void literal(Expression *e)
+    {
+        CtfeVmValue v;
+        if (!isVmLiteral(e) || !vmArrayOf(e, &v.a))
+        {
+            fail();
+            return;
+        }
+        result = constant(v);
+    }
+
+    void visit(VarExp *e)
+    {
+        VarDeclaration *v = e->var->isVarDeclaration();
+        if (!v)
+        {
+            fail();
+            return;
+        }
+
+        // Magic variable __ctfe is always true when interpreting
+        if (v->ident == Id::ctfe)
+        {
+            CtfeVmValue val;
+            val.i = 1;
+            result = constant(val);
+            return;
+        }
+
+        int r = findVar(v);
+        if (r >= 0)
+        {
+            result = r;
+            return;
+        }
+
+        // Constants with a literal initializer can be read from anywhere.
+        if ((v->isConst() || v->isImmutable() || v->storage_class & STCmanifest) &&
+            !(v->storage_class & (STCref | STCout | STClazy)) && v->init)
+        {
+            ExpInitializer *ie = v->init->isExpInitializer();
+            if (ie && isVmLiteral(ie->exp))
+            {
+                ie->exp->accept(this);
+                if (!failed)
+                    result = convert(result, ie->exp->type, e->type);
+                return;
+            }
+        }
+        fail();
+    }
+
+    void visit(DeclarationExp *e)
+    {
+        VarDeclaration *v = e->declaration->isVarDeclaration();
+        if (!v)
+        {
+            Dsymbol *s = e->declaration;
+            if (s->isAttribDeclaration() || s->isTemplateMixin() || s->isTupleDeclaration())
+                fail();
+            return;
+        }
+        if (v->toAlias() != v)
+        {
+            fail();
+            return;
+        }
+        if (v->isStatic() || v->storage_class & STCmanifest)
+            return;     // only readable through their initializer
+
+        Type *tb = v->type->toBasetype();
+        CtfeVmKind k = vmKind(tb);
+        if ((k != VMint && k != VMreal && k != VMarray) || tb->ty == Tsarray ||
+            v->isDataseg() || v->storage_class & (STCref | STCout | STClazy))
+        {
+            fail();
+            return;
+        }
+        ExpInitializer *ie = v->init ? v->init->isExpInitializer() : NULL;
+        if (!ie)
+        {
+            fail();
+            return;
+        }
+        newVar(v);
+        result = value(ie->exp);
+    }
+
+    void visit(AssignExp *e)
+    {
+        int rv;
+        VarDeclaration *v = localVar(e->e1, &rv);
+        if (!v || vmKind(e->e1->type) != vmKind(e->e2->type) ||
+            e->e1->type->toBasetype()->ty == Tsarray)
+        {
+            fail();
+            return;
+        }
+        int r = value(e->e2);
+        if (failed)
+            return;
+        r = convert(r, e->e2->type, e->e1->type);
+        emit(VMOPmov, 0, rv, r);
+        result = rv;
+    }
+
+    void visit(BinAssignExp *e)
+    {
+        int rv;
+        VarDeclaration *v = localVar(e->e1, &rv);
+        if (!v)
+        {
+            fail();
+            return;
+        }
+        int r2 = value(e->e2);
+        if (failed)
+            return;
+        int r = arith(e->op, e->type, e->e1->type, e->e2->type, rv, r2);
+        if (failed)
+            return;
+        r = convert(r, e->type, e->e1->type);
+        emit(VMOPmov, 0, rv, r);
+        result = rv;
+    }
+
+    void visit(PostExp *e)
+    {
+        int rv;
+        VarDeclaration *v = localVar(e->e1, &rv);
+        if (!v)
+        {
+            fail();
+            return;
+        }
+        int old = newReg();
+        emit(VMOPmov, 0, old, rv);
+        int r2 = value(e->e2);
+        if (failed)
+            return;
+        int r = arith(e->op == TOKplusplus ? TOKadd : TOKmin, e->type, e->e1->type, e->e2->type, rv, r2);
+        if (failed)
+            return;
+        r = convert(r, e->type, e->e1->type);
+        emit(VMOPmov, 0, rv, r);
+        result = old;
+    }
+
+    /* Emit the arithmetic operation op on the registers r1 and r2,
+     * with the semantics of the constfold.c function for op.
+     */
+    int arith(TOK op, Type *type, Type *t1, Type *t2, int r1, int r2)
+    {
+        CtfeVmKind k = vmKind(type);
+        CtfeVmKind k1 = vmKind(t1);
+        CtfeVmKind k2 = vmKind(t2);
+        int ty = type->toBasetype()->ty;
+        int ty1 = t1->toBasetype()->ty;
+        int r = newReg();
+
+        if (k == VMreal && (k1 == VMint || k1 == VMreal) && (k2 == VMint || k2 == VMreal))
+        {
+            r1 = convert(r1, t1, type);
+            r2 = convert(r2, t2, type);
+            switch (op)
+            {
+                case TOKadd:    case TOKaddass:     emit(VMOPradd, ty, r, r1, r2);  break;
+                case TOKmin:    case TOKminass:     emit(VMOPrmin, ty, r, r1, r2);  break;
+                case TOKmul:    case TOKmulass:     emit(VMOPrmul, ty, r, r1, r2);  break;
+                case TOKdiv:    case TOKdivass:     emit(VMOPrdiv, ty, r, r1, r2);  break;
+                default:
+                    return fail();
+            }
+            return r;
+        }
+        if (k != VMint || k1 != VMint || k2 != VMint)
+            return fail();
+
+        int flags = (t1->isunsigned() || t2->isunsigned()) ? VMFLAGunsigned : 0;
+        int bits = (int)(t1->size() * 8);
+        switch (op)
+        {
+            case TOKadd:    case TOKaddass:     emit(VMOPadd, ty, r, r1, r2);   break;
+            case TOKmin:    case TOKminass:     emit(VMOPmin, ty, r, r1, r2);   break;
+            case TOKmul:    case TOKmulass:     emit(VMOPmul, ty, r, r1, r2);   break;
+            case TOKand:    case TOKandass:     emit(VMOPand, ty, r, r1, r2);   break;
+            case TOKor:     case TOKorass:      emit(VMOPor, ty, r, r1, r2);    break;
+            case TOKxor:    case TOKxorass:     emit(VMOPxor, ty, r, r1, r2);   break;
+            case TOKdiv:    case TOKdivass:
+                emit(VMOPdiv, ty, r, r1, r2, 0, flags);
+                break;
+            case TOKmod:    case TOKmodass:
+                if (!type->isunsigned())
+                    flags |= VMFLAGmodcheck;
+                emit(VMOPmod, ty, r, r1, r2, 0, flags);
+                break;
+            case TOKshl:    case TOKshlass:
+                emit(VMOPshl, ty, r, r1, r2, bits, 0, ty1);
+                break;
+            case TOKshr:    case TOKshrass:
+                emit(VMOPshr, ty, r, r1, r2, bits, 0, ty1);
+                break;
+            case TOKushr:   case TOKushrass:
+                emit(VMOPushr, ty, r, r1, r2, bits, 0, ty1);
+                break;
+            default:
+                return fail();
+        }
+        return r;
+    }
+
+    void visit(BinExp *e)
+    {
+        switch (e->op)
+        {
+            case TOKadd:    case TOKmin:    case TOKmul:
+            case TOKdiv:    case TOKmod:
+            case TOKand:    case TOKor:     case TOKxor:
+            case TOKshl:    case TOKshr:    case TOKushr:
+            {
+                int r1 = operand(e->e1, e->e2);
+                int r2 = value(e->e2);
+                if (failed)
+                    return;
+                result = arith(e->op, e->type, e->e1->type, e->e2->type, r1, r2);
+                return;
+            }
+
+            case TOKequal:      case TOKnotequal:
+            case TOKidentity:   case TOKnotidentity:
+            case TOKlt:     case TOKle:     case TOKgt:     case TOKge:
+            case TOKleg:    case TOKlg:     case TOKunord:  case TOKue:
+            case TOKug:     case TOKuge:    case TOKul:     case TOKule:
+                compare(e);
+                return;
+
+            default:
+                fail();
+                return;
+        }
+    }
+
+    void compare(BinExp *e)
+    {
+        CtfeVmKind k1 = vmKind(e->e1->type);
+        CtfeVmKind k2 = vmKind(e->e2->type);
+        if (k1 != k2 || vmKind(e->type) != VMint)
+        {
+            fail();
+            return;
+        }
+        TOK op = e->op;
+        bool identity = (op == TOKidentity || op == TOKnotidentity);
+        if (op == TOKidentity)
+            op = TOKequal;
+        else if (op == TOKnotidentity)
+            op = TOKnotequal;
+
+        int r1 = operand(e->e1, e->e2);
+        int r2 = value(e->e2);
+        if (failed)
+            return;
+        int r = newReg();
+        int ty = e->type->toBasetype()->ty;
+
+        if (k1 == VMint)
+        {
+            int flags = (e->e1->type->isunsigned() || e->e2->type->isunsigned()) ? VMFLAGunsigned : 0;
+            emit(VMOPcmp, ty, r, r1, r2, op, flags);
+        }
+        else if (k1 == VMreal && !identity)
+            emit(VMOPrcmp, ty, r, r1, r2, op);
+        else if (k1 == VMarray && !identity && (op == TOKequal || op == TOKnotequal))
+        {
+            // Only arrays of integers, compared element by element.
+            Type *n1 = e->e1->type->toBasetype()->nextOf()->toBasetype();
+            Type *n2 = e->e2->type->toBasetype()->nextOf()->toBasetype();
+            if (vmKind(n1) != VMint || vmKind(n2) != VMint)
+            {
+                fail();
+                return;
+            }
+            emit(VMOParreq, n1->ty, r, r1, r2, op, 0, n2->ty);
+        }
+        else
+        {
+            fail();
+            return;
+        }
+        result = r;
+    }
+
+    void visit(AndAndExp *e)
+    {
+        logical(e, true);
+    }
+
+    void visit(OrOrExp *e)
+    {
+        logical(e, false);
+    }
+
+    void logical(BinExp *e, bool isandand)
+    {
+        int r1 = condition(e->e1);
+        if (failed)
+            return;
+        if (e->type->toBasetype()->ty == Tvoid)
+        {
+            size_t j = emit(isandand ? VMOPjz : VMOPjnz, 0, r1, -1);
+            discard(e->e2);
+            patch(j, code->code.dim);
+            result = -1;
+            return;
+        }
+        if (vmKind(e->type) != VMint)
+        {
+            fail();
+            return;
+        }
+        int ty = e->type->toBasetype()->ty;
+        int r = newReg();
+        emit(VMOPcast, ty, r, r1);
+        size_t j = emit(isandand ? VMOPjz : VMOPjnz, 0, r, -1);
+        int r2 = condition(e->e2);
+        if (failed)
+            return;
+        emit(VMOPcast, ty, r, r2);
+        patch(j, code->code.dim);
+        result = r;
+    }
+
+    void visit(NotExp *e)
+    {
+        int r1 = condition(e->e1);
+        if (failed)
+            return;
+        if (vmKind(e->type) != VMint)
+        {
+            fail();
+            return;
+        }
+        result = newReg();
+        emit(VMOPnot, e->type->toBasetype()->ty, result, r1);
+    }
+
+    void visit(NegExp *e)
+    {
+        CtfeVmKind k = vmKind(e->type);
+        if (vmKind(e->e1->type) != k || (k != VMint && k != VMreal))
+        {
+            fail();
+            return;
+        }
+        int r1 = value(e->e1);
+        if (failed)
+            return;
+        result = newReg();
+        emit(k == VMint ? VMOPneg : VMOPrneg, e->type->toBasetype()->ty, result, r1);
+    }
+
+    void visit(ComExp *e)
+    {
+        if (vmKind(e->type) != VMint || vmKind(e->e1->type) != VMint)
+        {
+            fail();
+            return;
+        }
+        int r1 = value(e->e1);
+        if (failed)
+            return;
+        result = newReg();
+        emit(VMOPcom, e->type->toBasetype()->ty, result, r1);
+    }
+
+    void visit(CastExp *e)
+    {
+        if (e->to->toBasetype()->ty == Tvoid)
+        {
+            discard(e->e1);
+            result = -1;
+            return;
+        }
+        int r1 = value(e->e1);
+        if (failed)
+            return;
+        if (e->type->toBasetype()->ty == Tbool && vmKind(e->e1->type) == VMreal)
+        {
+            // cast(bool) of a floating point value truncates it first
+            result = newReg();
+            emit(VMOPrtoi, Tbool, result, r1);
+            return;
+        }
+        result = convert(r1, e->e1->type, e->type);
+    }
+
+    void visit(CondExp *e)
+    {
+        int rc = condition(e->econd);
+        if (failed)
+            return;
+        size_t jelse = emit(VMOPjz, 0, rc, -1);
+        if (e->type->toBasetype()->ty == Tvoid)
+        {
+            discard(e->e1);
+            size_t jend = emit(VMOPjmp, 0, -1);
+            patch(jelse, code->code.dim);
+            discard(e->e2);
+            patch(jend, code->code.dim);
+            result = -1;
+            return;
+        }
+        CtfeVmKind k = vmKind(e->type);
+        if (k != VMint && k != VMreal && k != VMarray)
+        {
+            fail();
+            return;
+        }
+        int r = newReg();
+        int r1 = value(e->e1);
+        if (failed)
+            return;
+        emit(VMOPmov, 0, r, convert(r1, e->e1->type, e->type));
+        size_t jend = emit(VMOPjmp, 0, -1);
+        patch(jelse, code->code.dim);
+        int r2 = value(e->e2);
+        if (failed)
+            return;
+        emit(VMOPmov, 0, r, convert(r2, e->e2->type, e->type));
+        patch(jend, code->code.dim);
+        result = r;
+    }
+
+    void visit(CommaExp *e)
+    {
+        discard(e->e1);
+        if (failed)
+            return;
+        result = -1;
+        e->e2->accept(this);
+    }
+
+    void visit(ArrayLengthExp *e)
+    {
+        if (vmKind(e->e1->type) != VMarray)
+        {
+            fail();
+            return;
+        }
+        int r1 = value(e->e1);
+        if (failed)
+            return;
+        result = newReg();
+        emit(VMOPlen, e->type->toBasetype()->ty, result, r1);
+    }
+
+    void visit(IndexExp *e)
+    {
+        CtfeVmKind k = vmKind(e->type);
+        if (vmKind(e->e1->type) != VMarray || (k != VMint && k != VMreal) ||
+            vmKind(e->e2->type) != VMint)
+        {
+            fail();
+            return;
+        }
+        int r1 = operand(e->e1, e->e2);
+        if (failed)
+            return;
+        lengthVar(e->lengthVar, r1);
+        int r2 = value(e->e2);
+        if (failed)
+            return;
+        result = newReg();
+        emit(VMOPindex, e->type->toBasetype()->ty, result, r1, r2, 0,
+             k == VMreal ? VMFLAGreal : 0);
+    }
+
+    void visit(SliceExp *e)
+    {
+        if (vmKind(e->e1->type) != VMarray || vmKind(e->type) != VMarray)
+        {
+            fail();
+            return;
+        }
+        if (!e->lwr)
+        {
+            result = value(e->e1);
+            return;
+        }
+        if (vmKind(e->lwr->type) != VMint || vmKind(e->upr->type) != VMint)
+        {
+            fail();
+            return;
+        }
+        int r1 = value(e->e1);
+        if (failed)
+            return;
+        if (isVarReg(r1) && (writesLocals(e->lwr) || writesLocals(e->upr)))
+        {
+            int t = newReg();
+            emit(VMOPmov, 0, t, r1);
+            r1 = t;
+        }
+        lengthVar(e->lengthVar, r1);
+        int rl = operand(e->lwr, e->upr);
+        int ru = value(e->upr);
+        if (failed)
+            return;
+        result = newReg();
+        emit(VMOPslice, 0, result, r1, rl, ru);
+    }
+
+    void visit(CallExp *e)
+    {
+        if (e->e1->op != TOKvar)
+        {
+            fail();
+            return;
+        }
+        FuncDeclaration *f = ((VarExp *)e->e1)->var->isFuncDeclaration();
+        if (!f || f->isNested() || f->needThis() || !f->type || f->type->toBasetype()->ty != Tfunction)
+        {
+            fail();
+            return;
+        }
+        TypeFunction *tf = (TypeFunction *)f->type->toBasetype();
+        CtfeVmKind rk = vmKind(e->type);
+        size_t nargs = e->arguments ? e->arguments->dim : 0;
+        if (tf->varargs || tf->isref || (rk != VMint && rk != VMreal && rk != VMvoid) ||
+            Parameter::dim(tf->parameters) != nargs)
+        {
+            fail();
+            return;
+        }
+
+        // Arguments are passed in consecutive registers.
+        int args = (int)code->nregs;
+        code->nregs += nargs;
+        for (size_t i = 0; i < nargs; i++)
+        {
+            Parameter *p = Parameter::getNth(tf->parameters, i);
+            Expression *earg = (*e->arguments)[i];
+            CtfeVmKind k = vmKind(p->type);
+            if (p->storageClass & (STCout | STCref | STClazy) ||
+                (k != VMint && k != VMreal && k != VMarray) ||
+                p->type->toBasetype()->ty == Tsarray || vmKind(earg->type) != k)
+            {
+                fail();
+                return;
+            }
+            int r = value(earg);
+            if (failed)
+                return;
+            emit(VMOPmov, 0, args + (int)i, convert(r, earg->type, p->type));
+        }
+
+        size_t callee = 0;
+        while (callee < code->callees.dim && code->callees[callee] != f)
+            callee++;
+        if (callee == code->callees.dim)
+            code->callees.push(f);
+
+        int r = newReg();
+        emit(VMOPcall, 0, r, (int)callee, args, (int)nargs);
+        result = (rk == VMvoid) ? -1 : r;
+    }
+
+    void visit(AssertExp *e)
+    {
+        int r = condition(e->e1);
+        if (failed)
+            return;
+        emit(VMOPassert, 0, r);
+        result = -1;
+    }
+};
+
+/*************************************
+ * Compile fd to bytecode for the CTFE VM.
+ * Returns NULL if fd uses anything the VM does not support.
+ */
+CtfeVmCode *ctfeVmCompile(FuncDeclaration *fd)
+{
+    if (!fd->fbody || fd->isNested() || fd->needThis() || fd->vthis || fd->vresult)
+        return NULL;
+    Type *tb = fd->type->toBasetype();
+    if (tb->ty != Tfunction)
+        return NULL;
+    TypeFunction *tf = (TypeFunction *)tb;
+    CtfeVmKind retkind = vmKind(tf->next);
+    if (tf->varargs || tf->isref || (retkind != VMint && retkind != VMreal && retkind != VMvoid))
+        return NULL;
+
+    CtfeVmCode *code = new CtfeVmCode();
+    code->func = fd;
+    code->nparams = fd->parameters ? fd->parameters->dim : 0;
+    code->nregs = 0;
+    code->retkind = retkind;
+
+    code->memoize = retkind != VMvoid && code->nparams <= VM_MEMO_MAXARGS &&
+                    fd->isPureBypassingInference() == PUREstrong;
+
+    CtfeVmCompiler v(code);
+    for (size_t i = 0; i < code->nparams; i++)
+    {
+        VarDeclaration *p = (*fd->parameters)[i];
+        CtfeVmKind k = vmKind(p->type);
+        if ((k != VMint && k != VMreal && k != VMarray) ||
+            p->type->toBasetype()->ty == Tsarray ||
+            p->storage_class & (STCout | STCref | STClazy))
+            return NULL;
+        if (k != VMint)
+            code->memoize = false;
+        v.newVar(p);
+    }
+
+    fd->fbody->accept(&v);
+    if (v.failed)
+        return NULL;
+
+    // Falling off the end returns void, anything else is an error.
+    if (retkind == VMvoid)
+        v.emit(VMOPretvoid, 0, 0);
+    else
+        v.emit(VMOPbail, 0, 0);
+
+    // Resolve the jumps to case and default statements.
+    for (size_t i = 0; i < v.gotos.dim; i++)
+    {
+        size_t j = 0;
+        while (j < v.labels.dim && v.labels[j] != v.gotos[i])
+            j++;
+        if (j == v.labels.dim)
+            return NULL;
+        v.patch(v.gotoinsns[i], v.labelpos[j]);
+    }
+
+#if LOG
+    printf("%s CtfeVm: compiled %s, %d instructions, %d registers\n",
+        fd->loc.toChars(), fd->toChars(), (int)code->code.dim, (int)code->nregs);
+#endif
+    return code;
+}
+
+/* Find the bytecode for a function called from the VM,
+ * performing the checks that interpret() would do first.
+ */
+static int vmCallee(FuncDeclaration *fd, size_t nargs, CtfeVmCode **pcode)
+{
+    *pcode = NULL;
+    if (fd->semanticRun >= PASSsemantic3done && fd->semantic3Errors)
+        return VMbail;
+    if (isBuiltin(fd) == BUILTINyes)
+        return VMunsupported;
+    if (!fd->fbody || fd->semanticRun == PASSsemantic3)
+        return VMbail;
+    if (!fd->functionSemantic3() || fd->semanticRun < PASSsemantic3done || fd->semantic3Errors)
+        return VMbail;
+    if (!fd->ctfeCode)
+        ctfeCompile(fd);
+    if (!fd->ctfeVmCode || fd->ctfeVmCode->nparams != nargs)
+        return VMunsupported;
+    *pcode = fd->ctfeVmCode;
+    return VMreturn;
+}
+
+/* Run code in the frame starting at vmstack[base], whose parameters
+ * have already been set.
+ */
+static int vmExecute(CtfeVmCode *code, size_t base, CtfeVmValue *retval, int depth)
+{
+    ++CtfeStatus::numVmCalls;
+    if (CtfeStatus::callDepth + depth > CTFE_RECURSION_LIMIT)
+        return VMbail;
+
+    vmstack.setDim(base + code->nregs);
+    CtfeVmValue *regs = vmstack.tdata() + base;
+    CtfeVmValue *consts = code->consts.tdata();
+    CtfeVmInsn *insns = code->code.tdata();
+    int status = VMbail;
+
+    #define R(x)    regs[insn->x]
+    for (size_t ip = 0; ; )
+    {
+        CtfeVmInsn *insn = &insns[ip++];
+        switch (insn->op)
+        {
+            case VMOPmov:   R(a) = R(b);                break;
+            case VMOPconst: R(a) = consts[insn->b];     break;
+
+            case VMOPadd:   R(a).i = vmNormalize(insn->ty, R(b).i + R(c).i);    break;
+            case VMOPmin:   R(a).i = vmNormalize(insn->ty, R(b).i - R(c).i);    break;
+            case VMOPmul:   R(a).i = vmNormalize(insn->ty, R(b).i * R(c).i);    break;
+            case VMOPand:   R(a).i = vmNormalize(insn->ty, R(b).i & R(c).i);    break;
+            case VMOPor:    R(a).i = vmNormalize(insn->ty, R(b).i | R(c).i);    break;
+            case VMOPxor:   R(a).i = vmNormalize(insn->ty, R(b).i ^ R(c).i);    break;
+
+            case VMOPdiv:
+            case VMOPmod:
+            {
+                dinteger_t n1 = R(b).i;
+                dinteger_t n2 = R(c).i;
+                dinteger_t n;
+                if (n2 == 0)
+                    goto Lbail;
+                if (insn->flags & VMFLAGunsigned)
+                {
+                    if (insn->flags & VMFLAGmodcheck && n2 == (dinteger_t)-1 &&
+                        (n1 == 0xFFFFFFFF80000000ULL || n1 == 0x8000000000000000ULL))
+                        goto Lbail;
+                    n = (insn->op == VMOPdiv) ? n1 / n2 : n1 % n2;
+                }
+                else
+                {
+                    if (n2 == (dinteger_t)-1 &&
+                        (n1 == 0x8000000000000000ULL ||
+                         (insn->flags & VMFLAGmodcheck && n1 == 0xFFFFFFFF80000000ULL)))
+                        goto Lbail;
+                    n = (insn->op == VMOPdiv) ? (sinteger_t)n1 / (sinteger_t)n2
+                                              : (sinteger_t)n1 % (sinteger_t)n2;
+                }
+                R(a).i = vmNormalize(insn->ty, n);
+                break;
+            }
+
+            case VMOPshl:
+            case VMOPshr:
+            case VMOPushr:
+            {
+                dinteger_t value = R(b).i;
+                dinteger_t count = R(c).i;
+                if (count >= (dinteger_t)insn->d)
+                    goto Lbail;
+                if (insn->op == VMOPshl)
+                    value <<= count;
+                else if (insn->op == VMOPshr && vmIsSigned(insn->ty2))
+                    value = (sinteger_t)value >> count;
+                else
+                {
+                    if (insn->d < 64)
+                        value &= (1ULL << insn->d) - 1;
+                    value >>= count;
+                }
+                R(a).i = vmNormalize(insn->ty, value);
+                break;
+            }
+
+            case VMOPneg:   R(a).i = vmNormalize(insn->ty, -R(b).i);    break;
+            case VMOPcom:   R(a).i = vmNormalize(insn->ty, ~R(b).i);    break;
+            case VMOPnot:   R(a).i = (R(b).i == 0);                     break;
+
+            case VMOPcmp:
+            {
+                dinteger_t n1 = R(b).i;
+                dinteger_t n2 = R(c).i;
+                TOK op = (TOK)insn->d;
+                int n;
+                if (op == TOKequal)
+                    n = (n1 == n2);
+                else if (op == TOKnotequal)
+                    n = (n1 != n2);
+                else if (insn->flags & VMFLAGunsigned)
+                    n = intUnsignedCmp(op, n1, n2);
+                else
+                    n = intSignedCmp(op, n1, n2);
+                R(a).i = n;
+                break;
+            }
+
+            case VMOPradd:  R(a).r = R(b).r + R(c).r;   break;
+            case VMOPrmin:  R(a).r = R(b).r - R(c).r;   break;
+            case VMOPrmul:  R(a).r = R(b).r * R(c).r;   break;
+            case VMOPrdiv:  R(a).r = R(b).r / R(c).r;   break;
+            case VMOPrneg:  R(a).r = -R(b).r;           break;
+
+            case VMOPrcmp:
+            {
+                real_t r1 = R(b).r;
+                real_t r2 = R(c).r;
+                TOK op = (TOK)insn->d;
+                int n;
+                if (op == TOKequal || op == TOKnotequal)
+                {
+                    n = !Port::isNan(r1) && !Port::isNan(r2) && r1 == r2;
+                    if (op == TOKnotequal)
+                        n ^= 1;
+                }
+                else
+                    n = realCmp(op, r1, r2);
+                R(a).i = n;
+                break;
+            }
+
+            case VMOPrbool: R(a).i = (R(b).r != ldouble(0));    break;
+
+            case VMOPcast:  R(a).i = vmNormalize(insn->ty, R(b).i);     break;
+
+            case VMOPitor:
+                if (insn->flags & VMFLAGunsigned)
+                    R(a).r = ldouble((d_uns64)R(b).i);
+                else
+                    R(a).r = ldouble((d_int64)R(b).i);
+                break;
+
+            case VMOPrtoi:
+            {
+                real_t r = R(b).r;
+                dinteger_t n;
+                switch (insn->ty)
+                {
+                    case Tbool:     n = ((d_int64)r != 0);  break;
+                    case Tint8:     n = (d_int8)r;      break;
+                    case Tchar:
+                    case Tuns8:     n = (d_uns8)r;      break;
+                    case Tint16:    n = (d_int16)r;     break;
+                    case Twchar:
+                    case Tuns16:    n = (d_uns16)r;     break;
+                    case Tint32:    n = (d_int32)r;     break;
+                    case Tdchar:
+                    case Tuns32:    n = (d_uns32)r;     break;
+                    case Tint64:    n = (d_int64)r;     break;
+                    case Tuns64:    n = (d_uns64)r;     break;
+                    default:
+                        assert(0);
+                        n = 0;
+                }
+                R(a).i = vmNormalize(insn->ty, n);
+                break;
+            }
+
+            case VMOPlen:   R(a).i = vmNormalize(insn->ty, R(b).a.length);  break;
+
+            case VMOPindex:
+            {
+                dinteger_t i = R(c).i;
+                if (i >= R(b).a.length)
+                    goto Lbail;
+                CtfeVmArray arr = R(b).a;
+                if (!vmReadElement(&arr, (size_t)i, insn->ty, (insn->flags & VMFLAGreal) != 0, &R(a)))
+                    goto Lbail;
+                break;
+            }
+
+            case VMOPslice:
+            {
+                CtfeVmArray arr = R(b).a;
+                dinteger_t lwr = R(c).i;
+                dinteger_t upr = R(d).i;
+                if (lwr > upr || upr > arr.length)
+                    goto Lbail;
+                arr.lwr += (size_t)lwr;
+                arr.length = (size_t)(upr - lwr);
+                if (!arr.length)
+                    arr.agg = NULL;
+                R(a).a = arr;
+                break;
+            }
+
+            case VMOParreq:
+            {
+                CtfeVmArray a1 = R(b).a;
+                CtfeVmArray a2 = R(c).a;
+                int n = (a1.length == a2.length);
+                for (size_t i = 0; n && i < a1.length; i++)
+                {
+                    CtfeVmValue v1, v2;
+                    if (!vmReadElement(&a1, i, insn->ty, false, &v1) ||
+                        !vmReadElement(&a2, i, insn->ty2, false, &v2))
+                        goto Lbail;
+                    n = (v1.i == v2.i);
+                }
+                if ((TOK)insn->d == TOKnotequal)
+                    n ^= 1;
+                R(a).i = n;
+                break;
+            }
+
+            case VMOPjmp:
+                ip = insn->a;
+                break;
+
+            case VMOPjz:
+                if (!R(a).i)
+                    ip = insn->b;
+                break;
+
+            case VMOPjnz:
+                if (R(a).i)
+                    ip = insn->b;
+                break;
+
+            case VMOPcall:
+            {
+                CtfeVmCode *callee;
+                int st = vmCallee(code->callees[insn->b], insn->d, &callee);
+                // Compiling the callee may run CTFE, which can grow vmstack
+                regs = vmstack.tdata() + base;
+                if (st == VMreturn)
+                {
+                    CtfeVmMemoEntry *memo = NULL;
+                    if (callee->memoize)
+                    {
+                        memo = vmMemoSlot(callee, &R(c));
+                        if (vmMemoMatch(memo, callee, &R(c)))
+                        {
+                            ++CtfeStatus::numMemoHits;
+                            R(a) = memo->ret;
+                            break;
+                        }
+                        ++CtfeStatus::numMemoMisses;
+                    }
+                    size_t nbase = base + code->nregs;
+                    vmstack.setDim(nbase + callee->nregs);
+                    memcpy(vmstack.tdata() + nbase, vmstack.tdata() + base + insn->c,
+                           insn->d * sizeof(CtfeVmValue));
+                    CtfeVmValue v;
+                    st = vmExecute(callee, nbase, &v, depth + 1);
+                    vmstack.setDim(base + code->nregs);
+                    regs = vmstack.tdata() + base;
+                    if (st == VMreturn)
+                    {
+                        R(a) = v;
+                        if (memo)
+                        {
+                            // The arguments are still in the caller's registers
+                            memo->code = callee;
+                            for (size_t i = 0; i < callee->nparams; i++)
+                                memo->args[i] = regs[insn->c + i].i;
+                            memo->ret = v;
+                        }
+                    }
+                }
+                if (st != VMreturn)
+                {
+                    status = st;
+                    goto Lbail;
+                }
+                break;
+            }
+
+            case VMOPret:
+                *retval = R(a);
+                return VMreturn;
+
+            case VMOPretvoid:
+                return VMreturn;
+
+            case VMOPassert:
+                if (!R(a).i)
+                    goto Lbail;
+                break;
+
+            case VMOPbail:
+                goto Lbail;
+
+            default:
+                assert(0);
+        }
+    }
+    #undef R
+
+Lbail:
+    if (status == VMunsupported)
+        code->func->ctfeVmCode = NULL;
+    return status;
+}
+
+/*************************************
+ * Run fd on the CTFE VM with the already interpreted arguments.
+ * Returns NULL if the call has to be done by the AST interpreter.
+ */
+Expression *ctfeVmInterpret(FuncDeclaration *fd, Expressions *arguments)
+{
+    CtfeVmCode *code = fd->ctfeVmCode;
+    size_t dim = arguments ? arguments->dim : 0;
+    if (!code || code->nparams != dim)
+        return NULL;
+
+    size_t base = vmstack.dim;
+    vmstack.setDim(base + code->nregs);
+    for (size_t i = 0; i < dim; i++)
+    {
+        Expression *earg = (*arguments)[i];
+        Type *t = (*fd->parameters)[i]->type;
+        CtfeVmValue *v = &vmstack[base + i];
+        switch (vmKind(t))
+        {
+            case VMint:
+                if (earg->op != TOKint64)
+                    goto Lfail;
+                v->i = vmNormalize(t->toBasetype()->ty, earg->toInteger());
+                break;
+
+            case VMreal:
+                if (earg->op != TOKfloat64)
+                    goto Lfail;
+                v->r = earg->toReal();
+                break;
+
+            case VMarray:
+                if (!vmArrayOf(earg, &v->a))
+                    goto Lfail;
+                break;
+
+            default:
+                goto Lfail;
+        }
+    }
+
+    {
+        CtfeVmValue ret;
+        int status = vmExecute(code, base, &ret, 1);
+        vmstack.setDim(base);
+        if (status != VMreturn)
+        {
+        #if LOG
+            printf("%s CtfeVm: falling back to the interpreter for %s\n", fd->loc.toChars(), fd->toChars());
+        #endif
+            ++CtfeStatus::numVmFallbacks;
+            return NULL;
+        }
+
+        Type *tret = ((TypeFunction *)fd->type->toBasetype())->next;
+        if (code->retkind == VMint)
+            return new IntegerExp(fd->loc, ret.i, tret);
+        if (code->retkind == VMreal)
+            return new RealExp(fd->loc, ret.r, tret);
+        return CTFEExp::voidexp;
+    }
+
+Lfail:
+    vmstack.setDim(base);
+    return NULL;
+}
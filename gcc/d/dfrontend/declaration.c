@@ -787,6 +787,7 @@ VarDeclaration::VarDeclaration(Loc loc, Type *type, Identifier *id, Initializer
     rundtor = NULL;
     edtor = NULL;
     range = NULL;
+    boundsArray = NULL;
 }
 
 Dsymbol *VarDeclaration::syntaxCopy(Dsymbol *s)
@@ -1417,6 +1418,13 @@ Lnomatch:
                         FuncDeclaration *f = ((FuncExp *)ex)->fd;
                         f->tookAddressOf--;
                     }
+                    else if (ex->op == TOKdelegate)
+                    {
+                        // or the address of a nested function
+                        FuncDeclaration *f = ((DelegateExp *)ex)->func;
+                        if (f->isNested() && f->tookAddressOf > 0)
+                            f->tookAddressOf--;
+                    }
                 }
             }
             else
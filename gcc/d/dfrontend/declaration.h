@@ -30,6 +30,7 @@ class ExpInitializer;
 class StructDeclaration;
 struct InterState;
 struct CompiledCtfeFunction;
+struct CtfeVmCode;
 
 enum LINK;
 enum TOK;
@@ -261,6 +262,7 @@ public:
                                 // dtor calls on postblitted vars
     Expression *edtor;          // if !=NULL, does the destruction of the variable
     IntRange *range;            // if !NULL, the variable is known to be within the range
+    VarDeclaration *boundsArray; // if !NULL, the variable is known to be less than boundsArray.length
 
     VarDeclaration(Loc loc, Type *t, Identifier *id, Initializer *init);
     Dsymbol *syntaxCopy(Dsymbol *);
@@ -572,6 +574,7 @@ public:
     Statement *frequire;
     Statement *fensure;
     Statement *fbody;
+    bool sharedBody;                    // fbody is still the template's, see copyBody()
 
     FuncDeclarations foverrides;        // functions this function overrides
     FuncDeclaration *fdrequire;         // function that does the in contract
@@ -600,6 +603,7 @@ public:
     ILS inlineStatusExp;
 
     CompiledCtfeFunction *ctfeCode;     // Compiled code for interpreter
+    CtfeVmCode *ctfeVmCode;             // Bytecode for the CTFE VM, NULL if not compilable
     int inlineNest;                     // !=0 if nested inline
     bool isArrayOp;                     // true if array operation
     bool semantic3Errors;               // true if errors in semantic3
@@ -642,8 +646,15 @@ public:
 
     unsigned flags;                     // FUNCFLAGxxxxx
 
+    // Function bodies copied from templates are shared until needed
+    static int deferBodyCopy;           // !=0 while copying template members
+    static size_t numSharedBodies;
+    static size_t numCopiedBodies;
+    static size_t copiedBodyBytes;
+
     FuncDeclaration(Loc loc, Loc endloc, Identifier *id, StorageClass storage_class, Type *type);
     Dsymbol *syntaxCopy(Dsymbol *);
+    void copyBody();
     void semantic(Scope *sc);
     void semantic2(Scope *sc);
     void semantic3(Scope *sc);
@@ -688,6 +699,7 @@ public:
     bool setGC();
 
     void printGCUsage(Loc loc, const char *warn);
+    void printClosureUsage();
     bool isolateReturn();
     bool parametersIntersect(Type *t);
     virtual bool isNested();
@@ -870,6 +870,9 @@ ScopeDsymbol::ScopeDsymbol()
     symtab = NULL;
     imports = NULL;
     prots = NULL;
+    searchCache = NULL;
+    searchCacheGeneration = 0;
+    imported = false;
 }
 
 ScopeDsymbol::ScopeDsymbol(Identifier *id)
@@ -879,6 +882,9 @@ ScopeDsymbol::ScopeDsymbol(Identifier *id)
     symtab = NULL;
     imports = NULL;
     prots = NULL;
+    searchCache = NULL;
+    searchCacheGeneration = 0;
+    imported = false;
 }
 
 Dsymbol *ScopeDsymbol::syntaxCopy(Dsymbol *s)
@@ -889,6 +895,18 @@ Dsymbol *ScopeDsymbol::syntaxCopy(Dsymbol *s)
     return sds;
 }
 
+struct SearchCacheEntry
+{
+    SearchCacheEntry *next;     // entry for the same identifier with other flags
+    int flags;
+    Dsymbol *s;
+};
+
+size_t ScopeDsymbol::searchGeneration;
+size_t ScopeDsymbol::numSearchCycles;
+size_t ScopeDsymbol::numSearchCacheHits;
+size_t ScopeDsymbol::numSearchCacheMisses;
+
 /*****************************************
  * This function is #1 on the list of functions that eat cpu time.
  * Be very, very careful about slowing it down.
@@ -910,106 +928,151 @@ Dsymbol *ScopeDsymbol::search(Loc loc, Identifier *ident, int flags)
 
     if (imports)
     {
-        Dsymbol *s = NULL;
-        OverloadSet *a = NULL;
-        int sflags = flags & (IgnoreErrors | IgnoreAmbiguous); // remember these in recursive searches
+        /* Searching the imports can walk much of the import graph, so
+         * remember the results until this or an imported scope changes.
+         */
+        if (searchCache && searchCacheGeneration != searchGeneration)
+            searchCache = NULL;
+        SearchCacheEntry *sce = searchCache ? (SearchCacheEntry *)dmd_aaGetRvalue(searchCache, ident) : NULL;
+        for (; sce; sce = sce->next)
+        {
+            if (sce->flags == flags)
+            {
+                numSearchCacheHits++;
+                return sce->s;
+            }
+        }
+        numSearchCacheMisses++;
+
+        unsigned errors = global.errors;
+        size_t generation = searchGeneration;
+        size_t cycles = numSearchCycles;
+        Dsymbol *s = searchImports(loc, ident, flags);
 
-        // Look in imported modules
-        for (size_t i = 0; i < imports->dim; i++)
+        // Errors must be reported again by later searches
+        if (errors == global.errors &&
+            generation == searchGeneration &&
+            cycles == numSearchCycles)
         {
-            // If private import, don't search it
-            if ((flags & IgnorePrivateMembers) && prots[i] == PROTprivate)
-                continue;
+            if (!searchCache)
+                searchCacheGeneration = searchGeneration;
+            SearchCacheEntry **psce = (SearchCacheEntry **)dmd_aaGet(&searchCache, ident);
+            sce = new SearchCacheEntry();
+            sce->next = *psce;
+            sce->flags = flags;
+            sce->s = s;
+            *psce = sce;
+        }
+        return s;
+    }
 
-            Dsymbol *ss = (*imports)[i];
+    return s1;
+}
 
-            //printf("\tscanning import '%s', prots = %d, isModule = %p, isImport = %p\n", ss->toChars(), prots[i], ss->isModule(), ss->isImport());
-            /* Don't find private members if ss is a module
-             */
-            Dsymbol *s2 = ss->search(loc, ident, sflags | (ss->isModule() ? IgnorePrivateMembers : IgnoreNone));
-            if (!s)
+/*****************************************
+ * Search the imports of this scope for ident.
+ */
+
+Dsymbol *ScopeDsymbol::searchImports(Loc loc, Identifier *ident, int flags)
+{
+    Dsymbol *s = NULL;
+    OverloadSet *a = NULL;
+    int sflags = flags & (IgnoreErrors | IgnoreAmbiguous); // remember these in recursive searches
+
+    // Look in imported modules
+    for (size_t i = 0; i < imports->dim; i++)
+    {
+        // If private import, don't search it
+        if ((flags & IgnorePrivateMembers) && prots[i] == PROTprivate)
+            continue;
+
+        Dsymbol *ss = (*imports)[i];
+
+        //printf("\tscanning import '%s', prots = %d, isModule = %p, isImport = %p\n", ss->toChars(), prots[i], ss->isModule(), ss->isImport());
+        /* Don't find private members if ss is a module
+         */
+        Dsymbol *s2 = ss->search(loc, ident, sflags | (ss->isModule() ? IgnorePrivateMembers : IgnoreNone));
+        if (!s)
+        {
+            s = s2;
+            if (s && s->isOverloadSet())
+                a = mergeOverloadSet(a, s);
+        }
+        else if (s2 && s != s2)
+        {
+            if (s->toAlias() == s2->toAlias() ||
+                s->getType() == s2->getType() && s->getType())
             {
-                s = s2;
-                if (s && s->isOverloadSet())
-                    a = mergeOverloadSet(a, s);
+                /* After following aliases, we found the same
+                 * symbol, so it's not an ambiguity.  But if one
+                 * alias is deprecated or less accessible, prefer
+                 * the other.
+                 */
+                if (s->isDeprecated() ||
+                    s->prot().isMoreRestrictiveThan(s2->prot()) && s2->prot().kind != PROTnone)
+                    s = s2;
             }
-            else if (s2 && s != s2)
+            else
             {
-                if (s->toAlias() == s2->toAlias() ||
-                    s->getType() == s2->getType() && s->getType())
+                /* Two imports of the same module should be regarded as
+                 * the same.
+                 */
+                Import *i1 = s->isImport();
+                Import *i2 = s2->isImport();
+                if (!(i1 && i2 &&
+                      (i1->mod == i2->mod ||
+                       (!i1->parent->isImport() && !i2->parent->isImport() &&
+                        i1->ident->equals(i2->ident))
+                      )
+                     )
+                   )
                 {
-                    /* After following aliases, we found the same
-                     * symbol, so it's not an ambiguity.  But if one
-                     * alias is deprecated or less accessible, prefer
-                     * the other.
+                    /* Bugzilla 8668:
+                     * Public selective import adds AliasDeclaration in module.
+                     * To make an overload set, resolve aliases in here and
+                     * get actual overload roots which accessible via s and s2.
                      */
-                    if (s->isDeprecated() ||
-                        s->prot().isMoreRestrictiveThan(s2->prot()) && s2->prot().kind != PROTnone)
-                        s = s2;
-                }
-                else
-                {
-                    /* Two imports of the same module should be regarded as
-                     * the same.
+                    s = s->toAlias();
+                    s2 = s2->toAlias();
+
+                    /* If both s2 and s are overloadable (though we only
+                     * need to check s once)
                      */
-                    Import *i1 = s->isImport();
-                    Import *i2 = s2->isImport();
-                    if (!(i1 && i2 &&
-                          (i1->mod == i2->mod ||
-                           (!i1->parent->isImport() && !i2->parent->isImport() &&
-                            i1->ident->equals(i2->ident))
-                          )
-                         )
-                       )
+                    if ((s2->isOverloadSet() || s2->isOverloadable()) &&
+                        (a || s->isOverloadable()))
                     {
-                        /* Bugzilla 8668:
-                         * Public selective import adds AliasDeclaration in module.
-                         * To make an overload set, resolve aliases in here and
-                         * get actual overload roots which accessible via s and s2.
-                         */
-                        s = s->toAlias();
-                        s2 = s2->toAlias();
-
-                        /* If both s2 and s are overloadable (though we only
-                         * need to check s once)
-                         */
-                        if ((s2->isOverloadSet() || s2->isOverloadable()) &&
-                            (a || s->isOverloadable()))
-                        {
-                            a = mergeOverloadSet(a, s2);
-                            continue;
-                        }
-                        if (flags & IgnoreAmbiguous)    // if return NULL on ambiguity
-                            return NULL;
-                        if (!(flags & IgnoreErrors))
-                            ScopeDsymbol::multiplyDefined(loc, s, s2);
-                        break;
+                        a = mergeOverloadSet(a, s2);
+                        continue;
                     }
+                    if (flags & IgnoreAmbiguous)    // if return NULL on ambiguity
+                        return NULL;
+                    if (!(flags & IgnoreErrors))
+                        ScopeDsymbol::multiplyDefined(loc, s, s2);
+                    break;
                 }
             }
         }
+    }
 
-        if (s)
+    if (s)
+    {
+        /* Build special symbol if we had multiple finds
+         */
+        if (a)
         {
-            /* Build special symbol if we had multiple finds
-             */
-            if (a)
-            {
-                if (!s->isOverloadSet())
-                    a = mergeOverloadSet(a, s);
-                s = a;
-            }
+            if (!s->isOverloadSet())
+                a = mergeOverloadSet(a, s);
+            s = a;
+        }
 
-            if (!(flags & IgnoreErrors) && s->prot().kind == PROTprivate && !s->parent->isTemplateMixin())
-            {
-                if (!s->isImport())
-                    error(loc, "%s %s is private", s->kind(), s->toPrettyChars());
-            }
-            return s;
+        if (!(flags & IgnoreErrors) && s->prot().kind == PROTprivate && !s->parent->isTemplateMixin())
+        {
+            if (!s->isImport())
+                error(loc, "%s %s is private", s->kind(), s->toPrettyChars());
         }
+        return s;
     }
-
-    return s1;
+    return NULL;
 }
 
 OverloadSet *ScopeDsymbol::mergeOverloadSet(OverloadSet *os, Dsymbol *s)
@@ -1069,6 +1132,10 @@ void ScopeDsymbol::importScope(Dsymbol *s, Prot protection)
     // No circular or redundant import's
     if (s != this)
     {
+        clearSearchCache();
+        if (ScopeDsymbol *sds = s->isScopeDsymbol())
+            sds->imported = true;
+
         if (!imports)
             imports = new Dsymbols();
         else
@@ -1125,9 +1192,22 @@ const char *ScopeDsymbol::kind()
 
 Dsymbol *ScopeDsymbol::symtabInsert(Dsymbol *s)
 {
+    clearSearchCache();
     return symtab->insert(s);
 }
 
+/****************************************
+ * Forget the results of searching the imports, after a symbol or
+ * import was added.  Scopes that import this one must forget theirs too.
+ */
+
+void ScopeDsymbol::clearSearchCache()
+{
+    searchCache = NULL;
+    if (imported)
+        searchGeneration++;
+}
+
 /****************************************
  * Return true if any of the members are static ctors or static dtors, or if
  * any members have members that are.
@@ -150,6 +150,8 @@ typedef int (*Dsymbol_apply_ft_t)(Dsymbol *, void *);
 class Dsymbol : public RootObject
 {
 public:
+    DECLARE_ALLOCATOR(MEMdsymbol)
+
     Identifier *ident;
     Dsymbol *parent;
     Symbol *csym;               // symbol for code generator
@@ -300,8 +302,19 @@ public:
 private:
     Dsymbols *imports;          // imported Dsymbol's
     PROTKIND *prots;            // array of PROTKIND, one for each import
+    AA *searchCache;            // results of searching the imports, by Identifier
+    size_t searchCacheGeneration; // value of searchGeneration for searchCache
+    bool imported;              // this is in the imports of some other scope
+
+    Dsymbol *searchImports(Loc loc, Identifier *ident, int flags);
+    void clearSearchCache();
 
 public:
+    static size_t searchGeneration;     // changed when any imported scope changes
+    static size_t numSearchCycles;      // searches cut short by circular imports
+    static size_t numSearchCacheHits;
+    static size_t numSearchCacheMisses;
+
     ScopeDsymbol();
     ScopeDsymbol(Identifier *id);
     Dsymbol *syntaxCopy(Dsymbol *s);
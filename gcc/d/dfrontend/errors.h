@@ -48,6 +48,15 @@ void vdeprecation(Loc loc, const char *format, va_list ap, const char *p1 = NULL
 void vdeprecationSupplemental(Loc loc, const char *format, va_list ap);
 #endif
 
+/* While parsing on a worker thread of the parallel parser, diagnostics
+ * are saved instead of printed, and later replayed on the main thread
+ * at the point a serial compile would have printed them.
+ */
+struct DeferredDiagnostics;
+DeferredDiagnostics *startDeferringDiagnostics();
+void stopDeferringDiagnostics();
+void emitDeferredDiagnostics(DeferredDiagnostics *dd);
+
 #if defined(__GNUC__) || defined(__clang__)
 __attribute__((noreturn))
 void fatal();
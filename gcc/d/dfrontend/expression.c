@@ -1708,6 +1708,18 @@ bool functionParameters(Loc loc, Scope *sc, TypeFunction *tf,
                     FuncExp *fe = (FuncExp *)a;
                     fe->fd->tookAddressOf = 0;
                 }
+                else if (a->op == TOKarrayliteral && fd &&
+                         fd->isPureBypassingInference() >= PUREconst &&
+                         !tf->isref && !tf->nextOf()->hasPointers())
+                {
+                    /* 'scope' on the parameter is not checked, so an array
+                     * literal passed to it is only allocated on the stack
+                     * when the function cannot keep a reference to it:
+                     * it has no mutable indirections to store it in, nor
+                     * can it return it.
+                     */
+                    ((ArrayLiteralExp *)a)->onstack = true;
+                }
                 else if (a->op == TOKdelegate)
                 {
                     /* For passing a delegate to a scoped parameter,
@@ -1715,13 +1727,14 @@ bool functionParameters(Loc loc, Scope *sc, TypeFunction *tf,
                      * We only worry about 'escaping' references to the function.
                      */
                     DelegateExp *de = (DelegateExp *)a;
-                    if (de->e1->op == TOKvar)
-                    {   VarExp *ve = (VarExp *)de->e1;
-                        FuncDeclaration *f = ve->var->isFuncDeclaration();
-                        if (f)
-                        {   f->tookAddressOf--;
-                            //printf("tookAddressOf = %d\n", f->tookAddressOf);
-                        }
+                    FuncDeclaration *f = de->func;
+                    if (f->isNested() && f->tookAddressOf > 0)
+                    {
+                        /* Taking the address of a nested function always
+                         * counts, so this undoes the one made for &f.
+                         */
+                        f->tookAddressOf--;
+                        //printf("tookAddressOf = %d\n", f->tookAddressOf);
                     }
                 }
             }
@@ -2030,7 +2043,7 @@ Expression *Expression::copy()
 #endif
         assert(0);
     }
-    e = (Expression *)mem.xmalloc(size);
+    e = (Expression *)allocmemory(size, MEMexpression);
     //printf("Expression::copy(op = %d) e = %p\n", op, e);
     return (Expression *)memcpy((void*)e, (void*)this, size);
 }
@@ -3692,6 +3705,7 @@ StringExp::StringExp(Loc loc, char *string)
     this->committed = 0;
     this->postfix = 0;
     this->ownedByCtfe = 0;
+    this->ctfeCapacity = 0;
 }
 
 StringExp::StringExp(Loc loc, void *string, size_t len)
@@ -3703,6 +3717,7 @@ StringExp::StringExp(Loc loc, void *string, size_t len)
     this->committed = 0;
     this->postfix = 0;
     this->ownedByCtfe = 0;
+    this->ctfeCapacity = 0;
 }
 
 StringExp::StringExp(Loc loc, void *string, size_t len, utf8_t postfix)
@@ -3714,6 +3729,7 @@ StringExp::StringExp(Loc loc, void *string, size_t len, utf8_t postfix)
     this->committed = 0;
     this->postfix = postfix;
     this->ownedByCtfe = 0;
+    this->ctfeCapacity = 0;
 }
 
 StringExp *StringExp::create(Loc loc, char *s)
@@ -4008,6 +4024,8 @@ ArrayLiteralExp::ArrayLiteralExp(Loc loc, Expressions *elements)
 {
     this->elements = elements;
     this->ownedByCtfe = 0;
+    this->ctfeCapacity = 0;
+    this->onstack = false;
 }
 
 ArrayLiteralExp::ArrayLiteralExp(Loc loc, Expression *e)
@@ -4016,6 +4034,8 @@ ArrayLiteralExp::ArrayLiteralExp(Loc loc, Expression *e)
     elements = new Expressions;
     elements->push(e);
     this->ownedByCtfe = 0;
+    this->ctfeCapacity = 0;
+    this->onstack = false;
 }
 
 bool ArrayLiteralExp::equals(RootObject *o)
@@ -4143,6 +4163,7 @@ AssocArrayLiteralExp::AssocArrayLiteralExp(Loc loc,
     this->keys = keys;
     this->values = values;
     this->ownedByCtfe = 0;
+    this->ctfeIndex = NULL;
 }
 
 bool AssocArrayLiteralExp::equals(RootObject *o)
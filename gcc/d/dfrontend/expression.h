@@ -48,6 +48,7 @@ class StringExp;
 class ArrayExp;
 class SliceExp;
 struct UnionExp;
+struct CtfeAAIndex;
 
 #ifdef IN_GCC
 typedef union tree_node dt_t;
@@ -121,6 +122,8 @@ Expression *ctfeInterpretForPragmaMsg(Expression *e);
 class Expression : public RootObject
 {
 public:
+    DECLARE_ALLOCATOR(MEMexpression)
+
     Loc loc;                    // file location
     TOK op;                // handy to minimize use of dynamic_cast
     Type *type;                 // !=NULL means that semantic() has been run
@@ -383,6 +386,7 @@ public:
     unsigned char committed;    // !=0 if type is committed
     utf8_t postfix;      // 'c', 'w', 'd'
     int ownedByCtfe;    // 1: created in CTFE, 2: constant cached for CTFE
+    size_t ctfeCapacity;        // !=0 if CTFE append buffer: number of elements allocated
 
     StringExp(Loc loc, char *s);
     StringExp(Loc loc, void *s, size_t len);
@@ -439,6 +443,8 @@ class ArrayLiteralExp : public Expression
 public:
     Expressions *elements;
     int ownedByCtfe;    // 1: created in CTFE, 2: constant cached for CTFE
+    size_t ctfeCapacity;        // !=0 if CTFE append buffer: number of elements allocated
+    bool onstack;               // literal does not escape, allocate on stack
 
     ArrayLiteralExp(Loc loc, Expressions *elements);
     ArrayLiteralExp(Loc loc, Expression *e);
@@ -462,6 +468,7 @@ public:
     Expressions *keys;
     Expressions *values;
     int ownedByCtfe;    // 1: created in CTFE, 2: constant cached for CTFE
+    CtfeAAIndex *ctfeIndex;     // hash index of the keys, built by CTFE
 
     AssocArrayLiteralExp(Loc loc, Expressions *keys, Expressions *values);
     bool equals(RootObject *o);
@@ -31,6 +31,7 @@
 #include <errno.h>
 #include <unistd.h>
 #include <utime.h>
+#include <sys/mman.h>
 #endif
 
 #include "filename.h"
@@ -67,10 +68,8 @@ File::~File()
     {
         if (ref == 0)
             mem.xfree(buffer);
-#if _WIN32
         if (ref == 2)
-            UnmapViewOfFile(buffer);
-#endif
+            unmap();
     }
 }
 
@@ -191,6 +190,82 @@ err1:
 #endif
 }
 
+/*************************************
+ * Read file by memory mapping it read-only, instead of copying it
+ * into a malloc'd buffer.  The lexer needs two 0 bytes past the end
+ * of the data as a sentinel; the kernel zero fills the rest of the
+ * last page, so only map files that leave room for them there.
+ * Everything else (special files, small files, and files that end
+ * exactly on a page boundary) goes through File::read().
+ * Returns:
+ *      false       success
+ */
+
+// Below this size, read() is at least as fast as setting up a mapping.
+#define MMREAD_THRESHOLD (16 * 1024)
+
+bool File::mmread()
+{
+    if (len)
+        return false;               // already read the file
+#if POSIX
+    struct stat buf;
+    size_t size;
+    size_t pagesize;
+    void *p;
+
+    char *name = this->name->toChars();
+    int fd = open(name, O_RDONLY);
+    if (fd == -1)
+        return true;
+
+    if (fstat(fd, &buf) || !S_ISREG(buf.st_mode))
+        goto Lread;
+
+    size = (size_t)buf.st_size;
+    pagesize = (size_t)sysconf(_SC_PAGESIZE);
+    if (size < MMREAD_THRESHOLD || size % pagesize == 0 ||
+        pagesize - (size % pagesize) < 2)
+        goto Lread;
+
+    p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED)
+        goto Lread;
+    close(fd);
+
+    if (!ref)
+        ::free(buffer);
+    ref = 2;        // buffer is a mapping, unmap() it when done
+    buffer = (unsigned char *)p;
+    len = size;
+    assert(buffer[size] == 0 && buffer[size + 1] == 0);
+    return false;
+
+Lread:
+    close(fd);
+    return read();
+#else
+    return read();
+#endif
+}
+
+/*************************************
+ * Release a buffer set up by mmread().
+ */
+
+void File::unmap()
+{
+    assert(ref == 2);
+#if POSIX
+    munmap(buffer, len);
+#elif _WIN32
+    UnmapViewOfFile(buffer);
+#endif
+    buffer = NULL;
+    len = 0;
+    ref = 0;
+}
+
 /*********************************************
  * Write a file.
  * Returns:
@@ -42,6 +42,13 @@ struct File
 
     bool read();
 
+    /* Memory map file read-only if possible, otherwise read() it.
+     * Return true if error
+     */
+
+    bool mmread();
+    void unmap();
+
     /* Write file, return true if error
      */
 
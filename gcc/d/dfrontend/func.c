@@ -297,6 +297,7 @@ FuncDeclaration::FuncDeclaration(Loc loc, Loc endloc, Identifier *id, StorageCla
     returnLabel = NULL;
     fensure = NULL;
     fbody = NULL;
+    sharedBody = false;
     localsymtab = NULL;
     vthis = NULL;
     v_arguments = NULL;
@@ -315,6 +316,7 @@ FuncDeclaration::FuncDeclaration(Loc loc, Loc endloc, Identifier *id, StorageCla
     inlineStatusStmt = ILSuninitialized;
     inlineNest = 0;
     ctfeCode = NULL;
+    ctfeVmCode = NULL;
     isArrayOp = 0;
     semantic3Errors = false;
     fes = NULL;
@@ -337,6 +339,11 @@ FuncDeclaration::FuncDeclaration(Loc loc, Loc endloc, Identifier *id, StorageCla
     gotos = NULL;
 }
 
+int FuncDeclaration::deferBodyCopy;
+size_t FuncDeclaration::numSharedBodies;
+size_t FuncDeclaration::numCopiedBodies;
+size_t FuncDeclaration::copiedBodyBytes;
+
 Dsymbol *FuncDeclaration::syntaxCopy(Dsymbol *s)
 {
     //printf("FuncDeclaration::syntaxCopy('%s')\n", toChars());
@@ -346,11 +353,39 @@ Dsymbol *FuncDeclaration::syntaxCopy(Dsymbol *s)
     f->outId = outId;
     f->frequire = frequire ? frequire->syntaxCopy() : NULL;
     f->fensure  = fensure  ? fensure->syntaxCopy()  : NULL;
-    f->fbody    = fbody    ? fbody->syntaxCopy()    : NULL;
+    if (fbody && deferBodyCopy)
+    {
+        /* The members of a TemplateDeclaration never get semantic,
+         * so the copy can share the body until semantic3 needs it.
+         */
+        f->fbody = fbody;
+        f->sharedBody = true;
+        numSharedBodies++;
+    }
+    else
+        f->fbody = fbody ? fbody->syntaxCopy() : NULL;
     assert(!fthrows); // deprecated
     return f;
 }
 
+/****************************************************
+ * Give this function its own copy of a body shared with the
+ * template it was instantiated from, before anything modifies it.
+ */
+
+void FuncDeclaration::copyBody()
+{
+    if (!sharedBody)
+        return;
+    sharedBody = false;
+    if (!fbody)
+        return;
+    size_t bytes = allocmemory_bytes();
+    fbody = fbody->syntaxCopy();
+    numCopiedBodies++;
+    copiedBodyBytes += allocmemory_bytes() - bytes;
+}
+
 // Do the semantic analysis on the external interface to the function.
 
 void FuncDeclaration::semantic(Scope *sc)
@@ -1252,6 +1287,7 @@ void FuncDeclaration::semantic3(Scope *sc)
         return;
     semanticRun = PASSsemantic3;
     semantic3Errors = false;
+    copyBody();
 
     if (!type || type->ty != Tfunction)
         return;
@@ -4854,6 +4890,7 @@ void StaticCtorDeclaration::semantic(Scope *sc)
         e = new EqualExp(TOKnotequal, Loc(), e, new IntegerExp(1));
         s = new IfStatement(Loc(), NULL, e, new ReturnStatement(Loc(), NULL), NULL);
         sa->push(s);
+        copyBody();
         if (fbody)
             sa->push(fbody);
         fbody = new CompoundStatement(Loc(), sa);
@@ -4969,6 +5006,7 @@ void StaticDtorDeclaration::semantic(Scope *sc)
         e = new EqualExp(TOKnotequal, Loc(), e, new IntegerExp(0));
         s = new IfStatement(Loc(), NULL, e, new ReturnStatement(Loc(), NULL), NULL);
         sa->push(s);
+        copyBody();
         if (fbody)
             sa->push(fbody);
         fbody = new CompoundStatement(Loc(), sa);
@@ -112,6 +112,14 @@ struct Param
     const char *moduleDepsFile; // filename for deps output
     OutBuffer *moduleDeps;      // contents to be written to deps file
 
+    bool ctfeStats;             // gather CTFE profiling statistics
+    const char *ctfeStatsFile;  // filename for CTFE statistics
+    bool templateStats;         // gather template instance table statistics
+    const char *timeTraceFile;  // filename for template instantiation trace
+    bool lazySemantic;          // defer semantic of imported declarations until used
+    bool closureReport;         // list the closures allocated with the GC and why
+    bool boundsCheckReport;     // print the number of array bounds checks removed
+
 #ifdef IN_GCC
     const char *makeDepsFile;   // filename for make deps output
     OutBuffer *makeDeps;        // contents to be written to make deps file
@@ -180,6 +188,7 @@ struct Global
     FILE *stdmsg;          // where to send verbose messages
     unsigned gag;          // !=0 means gag reporting of errors & warnings
     unsigned gaggedErrors; // number of errors reported while gagged
+    unsigned totalErrors;  // number of errors reported, gagged or not, never decreased
 
     unsigned errorLimit;
 
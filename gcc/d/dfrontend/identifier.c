@@ -85,11 +85,24 @@ int Identifier::dyncast()
 
 StringTable Identifier::stringtable;
 
+/* Counter for generateId(prefix).  Each thread of the parallel parser
+ * numbers from its own base, see setGeneratedIdCount().
+ */
+static THREAD_LOCAL size_t generatedIds;
+
 Identifier *Identifier::generateId(const char *prefix)
 {
-    static size_t i;
+    return generateId(prefix, ++generatedIds);
+}
 
-    return generateId(prefix, ++i);
+size_t Identifier::getGeneratedIdCount()
+{
+    return generatedIds;
+}
+
+void Identifier::setGeneratedIdCount(size_t count)
+{
+    generatedIds = count;
 }
 
 Identifier *Identifier::generateId(const char *prefix, size_t i)
@@ -113,6 +126,7 @@ Identifier *Identifier::idPool(const char *s)
 
 Identifier *Identifier::idPool(const char *s, size_t len)
 {
+    Port::lock();
     StringValue *sv = stringtable.update(s, len);
     Identifier *id = (Identifier *) sv->ptrvalue;
     if (!id)
@@ -120,12 +134,15 @@ Identifier *Identifier::idPool(const char *s, size_t len)
         id = new Identifier(sv->toDchars(), TOKidentifier);
         sv->ptrvalue = (char *)id;
     }
+    Port::unlock();
     return id;
 }
 
 Identifier *Identifier::lookup(const char *s, size_t len)
 {
+    Port::lock();
     StringValue *sv = stringtable.lookup(s, len);
+    Port::unlock();
     if (!sv)
         return NULL;
     return (Identifier *)sv->ptrvalue;
@@ -38,6 +38,8 @@ public:
     static StringTable stringtable;
     static Identifier *generateId(const char *prefix);
     static Identifier *generateId(const char *prefix, size_t i);
+    static size_t getGeneratedIdCount();
+    static void setGeneratedIdCount(size_t count);
     static Identifier *idPool(const char *s);
     static Identifier *idPool(const char *s, size_t len);
     static Identifier *lookup(const char *s, size_t len);
@@ -37,6 +37,8 @@ enum NeedInterpret { INITnointerpret, INITinterpret };
 class Initializer : public RootObject
 {
 public:
+    DECLARE_ALLOCATOR(MEMinitializer)
+
     Loc loc;
 
     Initializer(Loc loc);
@@ -13,8 +13,10 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <string.h>                     // mem{cpy|set}()
+#include <time.h>                       // clock()
 
 #include "rmem.h"
+#include "stringtable.h"
 
 #include "statement.h"
 #include "expression.h"
@@ -51,9 +53,6 @@ Expression *interpret(Expression *e, InterState *istate, CtfeGoal goal = ctfeNee
 #define LOGCOMPILE 0
 #define SHOWPERFORMANCE 0
 
-// Maximum allowable recursive function calls in CTFE
-#define CTFE_RECURSION_LIMIT 1000
-
 /**
   The values of all CTFE variables
 */
@@ -85,6 +84,7 @@ private:
 
     size_t framepointer;      // current frame pointer
     size_t maxStackPointer;   // most stack we've ever used
+    size_t peakStackPointer;  // most stack used since the last startPeak()
     Expression *localThis;    // value of 'this', or NULL if none
 public:
     CtfeStack();
@@ -96,6 +96,10 @@ public:
 
     // Largest number of stack positions we've used
     size_t maxStackUsage();
+    // Start measuring the peak stack usage, returning the previous peak
+    size_t startPeak();
+    // Return the peak since startPeak(), and carry it over to the previous one
+    size_t endPeak(size_t oldpeak);
     // Start a new stack frame, using the provided 'this'.
     void startFrame(Expression *thisexp);
     void endFrame();
@@ -126,7 +130,7 @@ struct InterState
 
 CtfeStack ctfeStack;
 
-CtfeStack::CtfeStack() : framepointer(0), maxStackPointer(0)
+CtfeStack::CtfeStack() : framepointer(0), maxStackPointer(0), peakStackPointer(0)
 {
 }
 
@@ -146,6 +150,21 @@ size_t CtfeStack::maxStackUsage()
     return maxStackPointer;
 }
 
+size_t CtfeStack::startPeak()
+{
+    size_t oldpeak = peakStackPointer;
+    peakStackPointer = stackPointer();
+    return oldpeak;
+}
+
+size_t CtfeStack::endPeak(size_t oldpeak)
+{
+    size_t peak = peakStackPointer;
+    if (oldpeak > peakStackPointer)
+        peakStackPointer = oldpeak;
+    return peak;
+}
+
 void CtfeStack::startFrame(Expression *thisexp)
 {
     frames.push((void *)(size_t)(framepointer));
@@ -204,6 +223,8 @@ void CtfeStack::push(VarDeclaration *v)
     v->ctfeAdrOnStack = (int)values.dim;
     vars.push(v);
     values.push(NULL);
+    if (values.dim > peakStackPointer)
+        peakStackPointer = values.dim;
 }
 
 void CtfeStack::pop(VarDeclaration *v)
@@ -256,6 +277,11 @@ int CtfeStatus::stackTraceCallsToSuppress = 0;
 int CtfeStatus::maxCallDepth = 0;
 int CtfeStatus::numArrayAllocs = 0;
 int CtfeStatus::numAssignments = 0;
+int CtfeStatus::numVmCalls = 0;
+int CtfeStatus::numInterpretedCalls = 0;
+int CtfeStatus::numVmFallbacks = 0;
+int CtfeStatus::numMemoHits = 0;
+int CtfeStatus::numMemoMisses = 0;
 
 // CTFE diagnostic information
 void printCtfePerformanceStats()
@@ -265,6 +291,16 @@ void printCtfePerformanceStats()
     printf("max call depth = %d\tmax stack = %d\n", CtfeStatus::maxCallDepth, ctfeStack.maxStackUsage());
     printf("array allocs = %d\tassignments = %d\n\n", CtfeStatus::numArrayAllocs, CtfeStatus::numAssignments);
 #endif
+    if (CtfeStatus::numVmCalls || CtfeStatus::numInterpretedCalls)
+    {
+        fprintf(global.stdmsg, "ctfe      %d calls in VM, %d calls interpreted, %d fallbacks\n",
+            CtfeStatus::numVmCalls, CtfeStatus::numInterpretedCalls, CtfeStatus::numVmFallbacks);
+    }
+    if (CtfeStatus::numMemoHits || CtfeStatus::numMemoMisses)
+    {
+        fprintf(global.stdmsg, "ctfe      %d memoized calls, %d misses\n",
+            CtfeStatus::numMemoHits, CtfeStatus::numMemoMisses);
+    }
 }
 
 VarDeclaration *findParentVar(Expression *e);
@@ -275,6 +311,7 @@ Expression *evaluateDtor(InterState *istate, Expression *e);
 Expression *scrubReturnValue(Loc loc, Expression *e);
 
 Expression *scrubCacheValue(Loc loc, Expression *e);
+int RealEquals(real_t x1, real_t x2);
 
 
 /*************************************
@@ -288,10 +325,24 @@ struct CompiledCtfeFunction
     int numVars;           // Number of variables declared in this function
     Loc callingloc;
 
+    // Statistics for -fctfe-stats
+    int numCalls;          // Number of calls of this function
+    int numStatements;     // Number of statements executed in this function
+    int numArrayAllocs;    // Arrays allocated by calls, including callees
+    size_t peakStack;      // Most stack used by one call, including callees
+    clock_t time;          // Time spent in calls, including callees
+    int activeCalls;       // Number of calls currently being interpreted
+
     CompiledCtfeFunction(FuncDeclaration *f)
     {
         func = f;
         numVars = 0;
+        numCalls = 0;
+        numStatements = 0;
+        numArrayAllocs = 0;
+        peakStack = 0;
+        time = 0;
+        activeCalls = 0;
     }
 
     void onDeclaration(VarDeclaration *v)
@@ -699,9 +750,171 @@ public:
     }
 };
 
+/************** CTFE profiling ********************************************/
+
+/* A place outside of CTFE that started the interpreter
+ */
+struct CtfeCallSite
+{
+    Loc loc;
+    const char *expr;      // the expression interpreted there
+    int numEvaluations;    // number of times CTFE was started here
+    int numCalls;          // number of calls made, including nested ones
+    clock_t time;          // time spent interpreting
+};
+
+static Array<CompiledCtfeFunction *> profiledFuncs;
+static Array<CtfeCallSite *> profiledCallSites;
+static StringTable *callSiteTable;
+static int numProfiledCalls;
+
+static CompiledCtfeFunction *profileCall(FuncDeclaration *fd)
+{
+    CompiledCtfeFunction *ccf = fd->ctfeCode;
+    if (ccf->numCalls == 0)
+        profiledFuncs.push(ccf);
+    ++ccf->numCalls;
+    ++numProfiledCalls;
+    return ccf;
+}
+
+/* Measures an interpreted function call for -fctfe-stats,
+ * from its construction until it goes out of scope.
+ */
+struct CtfeCallProfile
+{
+    CompiledCtfeFunction *ccf;
+    clock_t start;
+    int numArrayAllocs;
+    size_t stackBase;
+    size_t oldPeak;
+
+    CtfeCallProfile(FuncDeclaration *fd)
+    {
+        ccf = NULL;
+        if (!global.params.ctfeStats || !fd->ctfeCode)
+            return;
+        ccf = profileCall(fd);
+        ++ccf->activeCalls;
+        start = clock();
+        numArrayAllocs = CtfeStatus::numArrayAllocs;
+        stackBase = ctfeStack.stackPointer();
+        oldPeak = ctfeStack.startPeak();
+    }
+
+    ~CtfeCallProfile()
+    {
+        if (!ccf)
+            return;
+        size_t peak = ctfeStack.endPeak(oldPeak) - stackBase;
+        if (peak > ccf->peakStack)
+            ccf->peakStack = peak;
+        // Recursive calls are already included in the outermost one
+        if (--ccf->activeCalls == 0)
+        {
+            ccf->time += clock() - start;
+            ccf->numArrayAllocs += CtfeStatus::numArrayAllocs - numArrayAllocs;
+        }
+    }
+};
+
+static void profileCallSite(Expression *e, int numCalls, clock_t time)
+{
+    if (!callSiteTable)
+    {
+        callSiteTable = new StringTable();
+        callSiteTable->_init();
+    }
+    const char *key = e->loc.toChars();
+    StringValue *sv = callSiteTable->update(key, strlen(key));
+    CtfeCallSite *site = (CtfeCallSite *)sv->ptrvalue;
+    if (!site)
+    {
+        site = new CtfeCallSite();
+        site->loc = e->loc;
+        const char *expr = e->toChars();
+        if (strlen(expr) > 60)
+        {
+            OutBuffer buf;
+            buf.write(expr, 57);
+            buf.writestring("...");
+            expr = buf.extractString();
+        }
+        site->expr = expr;
+        site->numEvaluations = 0;
+        site->numCalls = 0;
+        site->time = 0;
+        sv->ptrvalue = site;
+        profiledCallSites.push(site);
+    }
+    ++site->numEvaluations;
+    site->numCalls += numCalls;
+    site->time += time;
+}
+
+static int funcTimeCmp(const void *p1, const void *p2)
+{
+    CompiledCtfeFunction *f1 = *(CompiledCtfeFunction **)p1;
+    CompiledCtfeFunction *f2 = *(CompiledCtfeFunction **)p2;
+    if (f1->time != f2->time)
+        return f1->time < f2->time ? 1 : -1;
+    return f2->numCalls - f1->numCalls;
+}
+
+static int callSiteTimeCmp(const void *p1, const void *p2)
+{
+    CtfeCallSite *s1 = *(CtfeCallSite **)p1;
+    CtfeCallSite *s2 = *(CtfeCallSite **)p2;
+    if (s1->time != s2->time)
+        return s1->time < s2->time ? 1 : -1;
+    return s2->numCalls - s1->numCalls;
+}
+
+static double toMsecs(clock_t t)
+{
+    return (double)t * 1000 / CLOCKS_PER_SEC;
+}
+
+/*************************************
+ * Write the statistics gathered for -fctfe-stats to buf.
+ * Functions are listed by the time spent in them, followed
+ * by the places outside of CTFE that used the most time.
+ */
+void printCtfeProfile(OutBuffer *buf)
+{
+    const size_t maxCallSites = 20;
+
+    qsort(profiledFuncs.tdata(), profiledFuncs.dim, sizeof(CompiledCtfeFunction *), &funcTimeCmp);
+    qsort(profiledCallSites.tdata(), profiledCallSites.dim, sizeof(CtfeCallSite *), &callSiteTimeCmp);
+
+    buf->printf("CTFE statistics: %d calls of %d functions, %d evaluations\n",
+        numProfiledCalls, (int)profiledFuncs.dim, (int)profiledCallSites.dim);
+    buf->printf("Pure function calls: %d memoized, %d misses\n\n",
+        CtfeStatus::numMemoHits, CtfeStatus::numMemoMisses);
+    buf->writestring("     calls  statements   time (ms)  peak stack  array allocs  function\n");
+    for (size_t i = 0; i < profiledFuncs.dim; i++)
+    {
+        CompiledCtfeFunction *ccf = profiledFuncs[i];
+        buf->printf("%10d  %10d  %10.3f  %10d  %12d  %s at %s\n",
+            ccf->numCalls, ccf->numStatements, toMsecs(ccf->time),
+            (int)ccf->peakStack, ccf->numArrayAllocs,
+            ccf->func->toPrettyChars(), ccf->func->loc.toChars());
+    }
+
+    buf->writestring("\n     evals       calls   time (ms)  call site\n");
+    for (size_t i = 0; i < profiledCallSites.dim && i < maxCallSites; i++)
+    {
+        CtfeCallSite *site = profiledCallSites[i];
+        buf->printf("%10d  %10d  %10.3f  %s: %s\n",
+            site->numEvaluations, site->numCalls, toMsecs(site->time),
+            site->loc.toChars(), site->expr);
+    }
+}
+
 /*************************************
  * Compile this function for CTFE.
- * At present, this merely allocates variables.
+ * This allocates variables, and compiles the function
+ * to bytecode if the CTFE VM supports everything it uses.
  */
 void ctfeCompile(FuncDeclaration *fd)
 {
@@ -727,6 +940,11 @@ void ctfeCompile(FuncDeclaration *fd)
         fd->ctfeCode->onDeclaration(fd->vresult);
     CtfeCompiler v(fd->ctfeCode);
     v.ctfeCompile(fd->fbody);
+
+    // The profile counts the statements and stack of the interpreter,
+    // so with -fctfe-stats every call is interpreted.
+    if (!global.params.ctfeStats)
+        fd->ctfeVmCode = ctfeVmCompile(fd);
 }
 
 /*************************************
@@ -751,7 +969,16 @@ Expression *ctfeInterpret(Expression *e)
     ctfeCodeGlobal.callingloc = e->loc;
     ctfeCodeGlobal.onExpression(e);
 
+    clock_t start = 0;
+    int numCalls = numProfiledCalls;
+    if (global.params.ctfeStats)
+        start = clock();
+
     Expression *result = interpret(e, NULL);
+
+    // Only record the places that called a function
+    if (global.params.ctfeStats && numProfiledCalls != numCalls)
+        profileCallSite(e, numProfiledCalls - numCalls, clock() - start);
     if (!CTFEExp::isCantExp(result))
         result = scrubReturnValue(e->loc, result);
     if (CTFEExp::isCantExp(result))
@@ -812,6 +1039,425 @@ Expression *ctfeInterpretForPragmaMsg(Expression *e)
     return e;
 }
 
+/************** Memoization of pure calls ******************************/
+
+/* Calls of strongly pure functions are looked up in this cache,
+ * indexed by a hash of the function and its arguments.  Each slot
+ * holds a single call, so a new call replaces any other call with
+ * the same index.  Only literal values are cached, and the work done
+ * on any one value is limited.
+ */
+#define CTFE_MEMO_SIZE      4096
+#define CTFE_MEMO_BUDGET    4096
+
+struct CtfeMemoEntry
+{
+    FuncDeclaration *fd;
+    hash_t hash;
+    Expressions *arguments;     // copies of the arguments
+    Expression *result;         // the result, owned by the cache
+};
+
+static CtfeMemoEntry ctfeMemo[CTFE_MEMO_SIZE];
+
+static bool isArrayValue(Expression *e)
+{
+    return e->op == TOKstring || e->op == TOKarrayliteral || e->op == TOKslice;
+}
+
+// Get element i of the array literal agg as an integer
+static bool getArrayInteger(Expression *agg, size_t i, dinteger_t mask, dinteger_t *pvalue)
+{
+    if (agg->op == TOKstring)
+    {
+        *pvalue = ((StringExp *)agg)->charAt(i) & mask;
+        return true;
+    }
+    Expression *el = (*((ArrayLiteralExp *)agg)->elements)[i];
+    if (el->op != TOKint64)
+        return false;
+    *pvalue = el->toInteger() & mask;
+    return true;
+}
+
+// Return the mask for the elements of the integer array e, or 0
+static dinteger_t arrayIntegerMask(Expression *e)
+{
+    Type *tn = e->type->toBasetype()->nextOf();
+    if (!tn || !tn->toBasetype()->isintegral())
+        return 0;
+    d_uns64 sz = tn->toBasetype()->size();
+    return sz < 8 ? ((dinteger_t)1 << (sz * 8)) - 1 : ~(dinteger_t)0;
+}
+
+/* Add the literal value e to the hash *ph.
+ * Return false if e cannot be memoized.
+ */
+static bool memoHash(Expression *e, hash_t *ph, int *budget)
+{
+    if (--*budget < 0)
+        return false;
+
+    hash_t h = *ph;
+    if (isArrayValue(e))
+    {
+        Expression *agg;
+        size_t lwr;
+        size_t len;
+        if (!getArrayBounds(e, &agg, &lwr, &len))
+            return false;
+        if (!agg)
+        {
+            *ph = h * 31 + TOKnull;
+            return true;
+        }
+        h = h * 31 + TOKarrayliteral;
+        h = h * 31 + len;
+        if (dinteger_t mask = arrayIntegerMask(e))
+        {
+            *budget -= len / 16;
+            if (*budget < 0)
+                return false;
+            for (size_t i = 0; i < len; i++)
+            {
+                dinteger_t value;
+                if (!getArrayInteger(agg, lwr + i, mask, &value))
+                    return false;
+                h = h * 31 + (hash_t)value;
+            }
+        }
+        else
+        {
+            if (agg->op != TOKarrayliteral)
+                return false;
+            Expressions *elements = ((ArrayLiteralExp *)agg)->elements;
+            for (size_t i = 0; i < len; i++)
+            {
+                if (!memoHash((*elements)[lwr + i], &h, budget))
+                    return false;
+            }
+        }
+        *ph = h;
+        return true;
+    }
+
+    h = h * 31 + e->op;
+    switch (e->op)
+    {
+        case TOKint64:
+            h = h * 31 + (hash_t)e->toInteger();
+            break;
+
+        case TOKfloat64:
+        case TOKcomplex80:
+        case TOKnull:
+        case TOKvoid:
+            break;
+
+        case TOKstructliteral:
+        {
+            Expressions *elements = ((StructLiteralExp *)e)->elements;
+            for (size_t i = 0; i < elements->dim; i++)
+            {
+                Expression *el = (*elements)[i];
+                if (!el)
+                    h = h * 31;
+                else if (!memoHash(el, &h, budget))
+                    return false;
+            }
+            break;
+        }
+
+        case TOKassocarrayliteral:
+        {
+            AssocArrayLiteralExp *aae = (AssocArrayLiteralExp *)e;
+            for (size_t i = 0; i < aae->keys->dim; i++)
+            {
+                if (!memoHash((*aae->keys)[i], &h, budget) ||
+                    !memoHash((*aae->values)[i], &h, budget))
+                    return false;
+            }
+            break;
+        }
+
+        default:
+            return false;
+    }
+    *ph = h;
+    return true;
+}
+
+// Return true if the literal values e1 and e2 are identical
+static bool memoEquals(Expression *e1, Expression *e2)
+{
+    if (isArrayValue(e1) || isArrayValue(e2))
+    {
+        Expression *agg1;
+        Expression *agg2;
+        size_t lwr1, len1;
+        size_t lwr2, len2;
+        if (!isArrayValue(e1) || !isArrayValue(e2) ||
+            !getArrayBounds(e1, &agg1, &lwr1, &len1) ||
+            !getArrayBounds(e2, &agg2, &lwr2, &len2))
+            return false;
+        if (!agg1 || !agg2)
+            return !agg1 && !agg2;
+        if (len1 != len2)
+            return false;
+        if (dinteger_t mask = arrayIntegerMask(e1))
+        {
+            for (size_t i = 0; i < len1; i++)
+            {
+                dinteger_t v1, v2;
+                if (!getArrayInteger(agg1, lwr1 + i, mask, &v1) ||
+                    !getArrayInteger(agg2, lwr2 + i, mask, &v2) ||
+                    v1 != v2)
+                    return false;
+            }
+            return true;
+        }
+        if (agg1->op != TOKarrayliteral || agg2->op != TOKarrayliteral)
+            return false;
+        for (size_t i = 0; i < len1; i++)
+        {
+            if (!memoEquals((*((ArrayLiteralExp *)agg1)->elements)[lwr1 + i],
+                            (*((ArrayLiteralExp *)agg2)->elements)[lwr2 + i]))
+                return false;
+        }
+        return true;
+    }
+
+    if (e1->op != e2->op)
+        return false;
+    switch (e1->op)
+    {
+        case TOKint64:
+            return e1->toInteger() == e2->toInteger();
+
+        case TOKfloat64:
+            return RealEquals(((RealExp *)e1)->value, ((RealExp *)e2)->value);
+
+        case TOKcomplex80:
+        {
+            complex_t c1 = e1->toComplex();
+            complex_t c2 = e2->toComplex();
+            return RealEquals(creall(c1), creall(c2)) && RealEquals(cimagl(c1), cimagl(c2));
+        }
+
+        case TOKnull:
+        case TOKvoid:
+            return true;
+
+        case TOKstructliteral:
+        {
+            StructLiteralExp *se1 = (StructLiteralExp *)e1;
+            StructLiteralExp *se2 = (StructLiteralExp *)e2;
+            if (se1->sd != se2->sd || se1->elements->dim != se2->elements->dim)
+                return false;
+            for (size_t i = 0; i < se1->elements->dim; i++)
+            {
+                Expression *el1 = (*se1->elements)[i];
+                Expression *el2 = (*se2->elements)[i];
+                if (!el1 || !el2 ? el1 != el2 : !memoEquals(el1, el2))
+                    return false;
+            }
+            return true;
+        }
+
+        case TOKassocarrayliteral:
+        {
+            AssocArrayLiteralExp *aae1 = (AssocArrayLiteralExp *)e1;
+            AssocArrayLiteralExp *aae2 = (AssocArrayLiteralExp *)e2;
+            if (aae1->keys->dim != aae2->keys->dim)
+                return false;
+            for (size_t i = 0; i < aae1->keys->dim; i++)
+            {
+                if (!memoEquals((*aae1->keys)[i], (*aae2->keys)[i]) ||
+                    !memoEquals((*aae1->values)[i], (*aae2->values)[i]))
+                    return false;
+            }
+            return true;
+        }
+
+        default:
+            return false;
+    }
+}
+
+static Expressions *copyMemoValues(Expressions *exps, size_t lwr, size_t len, int *budget);
+
+/* Return a copy of the literal value e that shares nothing with it,
+ * with all slices resolved, or NULL if e cannot be memoized.
+ */
+static Expression *copyMemoValue(Expression *e, int *budget)
+{
+    if (--*budget < 0)
+        return NULL;
+
+    if (isArrayValue(e))
+    {
+        Expression *agg;
+        size_t lwr;
+        size_t len;
+        if (!getArrayBounds(e, &agg, &lwr, &len))
+            return NULL;
+        if (!agg)
+            return new NullExp(e->loc, e->type);
+        if (agg->op == TOKstring)
+        {
+            StringExp *se = (StringExp *)agg;
+            *budget -= len / 16;
+            if (*budget < 0)
+                return NULL;
+            void *s = mem.xcalloc(len + 1, se->sz);
+            memcpy(s, (char *)se->string + lwr * se->sz, len * se->sz);
+            StringExp *r = new StringExp(e->loc, s, len);
+            r->type = e->type;
+            r->sz = se->sz;
+            r->committed = se->committed;
+            r->ownedByCtfe = 1;
+            return r;
+        }
+        Expressions *elements = copyMemoValues(((ArrayLiteralExp *)agg)->elements, lwr, len, budget);
+        if (!elements)
+            return NULL;
+        ArrayLiteralExp *r = new ArrayLiteralExp(e->loc, elements);
+        r->type = e->type;
+        r->ownedByCtfe = 1;
+        return r;
+    }
+
+    switch (e->op)
+    {
+        case TOKint64:
+        case TOKfloat64:
+        case TOKcomplex80:
+        case TOKnull:
+        case TOKvoid:
+            return copyLiteral(e).copy();
+
+        case TOKstructliteral:
+        {
+            StructLiteralExp *se = (StructLiteralExp *)e;
+            Expressions *elements = copyMemoValues(se->elements, 0, se->elements->dim, budget);
+            if (!elements)
+                return NULL;
+            StructLiteralExp *r = new StructLiteralExp(e->loc, se->sd, elements, se->stype);
+            r->type = e->type;
+            r->ownedByCtfe = 1;
+            r->origin = se->origin;
+            return r;
+        }
+
+        case TOKassocarrayliteral:
+        {
+            AssocArrayLiteralExp *aae = (AssocArrayLiteralExp *)e;
+            Expressions *keys = copyMemoValues(aae->keys, 0, aae->keys->dim, budget);
+            Expressions *values = copyMemoValues(aae->values, 0, aae->values->dim, budget);
+            if (!keys || !values)
+                return NULL;
+            AssocArrayLiteralExp *r = new AssocArrayLiteralExp(e->loc, keys, values);
+            r->type = e->type;
+            r->ownedByCtfe = 1;
+            return r;
+        }
+
+        default:
+            return NULL;
+    }
+}
+
+static Expressions *copyMemoValues(Expressions *exps, size_t lwr, size_t len, int *budget)
+{
+    Expressions *r = new Expressions();
+    r->setDim(len);
+    for (size_t i = 0; i < len; i++)
+    {
+        Expression *e = (*exps)[lwr + i];
+        if (e)
+        {
+            e = copyMemoValue(e, budget);
+            if (!e)
+                return NULL;
+        }
+        (*r)[i] = e;
+    }
+    return r;
+}
+
+// Return true if calls of fd may be memoized
+static bool isMemoizable(FuncDeclaration *fd, TypeFunction *tf)
+{
+    if (tf->isref || tf->varargs || !tf->next || tf->next->toBasetype()->ty == Tvoid)
+        return false;
+    if (fd->isPureBypassingInference() != PUREstrong)
+        return false;
+    size_t dim = Parameter::dim(tf->parameters);
+    for (size_t i = 0; i < dim; i++)
+    {
+        Parameter *fparam = Parameter::getNth(tf->parameters, i);
+        if (fparam->storageClass & (STCout | STCref | STClazy))
+            return false;
+    }
+    return true;
+}
+
+/* Look up the call of fd with the arguments eargs in the memo cache.
+ * Return a copy of the result if it is found.  Otherwise, return NULL
+ * and set *pentry to a new entry to be completed by memoStore(), or
+ * to NULL if the call cannot be memoized.
+ */
+static Expression *memoLookup(FuncDeclaration *fd, Expressions *eargs, CtfeMemoEntry **pentry)
+{
+    *pentry = NULL;
+    hash_t hash = (hash_t)fd;
+    int budget = CTFE_MEMO_BUDGET;
+    for (size_t i = 0; i < eargs->dim; i++)
+    {
+        if (!memoHash((*eargs)[i], &hash, &budget))
+            return NULL;
+    }
+
+    CtfeMemoEntry *entry = &ctfeMemo[hash % CTFE_MEMO_SIZE];
+    if (entry->fd == fd && entry->hash == hash)
+    {
+        size_t i = 0;
+        while (i < eargs->dim && memoEquals((*eargs)[i], (*entry->arguments)[i]))
+            i++;
+        if (i == eargs->dim)
+        {
+            ++CtfeStatus::numMemoHits;
+            budget = CTFE_MEMO_BUDGET;
+            return copyMemoValue(entry->result, &budget);
+        }
+    }
+    ++CtfeStatus::numMemoMisses;
+
+    // The function may modify its arguments, so copy them now
+    budget = CTFE_MEMO_BUDGET;
+    Expressions *arguments = copyMemoValues(eargs, 0, eargs->dim, &budget);
+    if (!arguments)
+        return NULL;
+    entry = new CtfeMemoEntry();
+    entry->fd = fd;
+    entry->hash = hash;
+    entry->arguments = arguments;
+    entry->result = NULL;
+    *pentry = entry;
+    return NULL;
+}
+
+// Add the result e of the call described by entry to the memo cache
+static void memoStore(CtfeMemoEntry *entry, Expression *e)
+{
+    int budget = CTFE_MEMO_BUDGET;
+    e = copyMemoValue(e, &budget);
+    if (!e)
+        return;
+    entry->result = scrubCacheValue(entry->fd->loc, e);
+    ctfeMemo[entry->hash % CTFE_MEMO_SIZE] = *entry;
+}
+
 /*************************************
  * Attempt to interpret a function given the arguments.
  * Input:
@@ -929,6 +1575,31 @@ Expression *interpret(FuncDeclaration *fd, InterState *istate, Expressions *argu
         eargs[i] = earg;
     }
 
+    CtfeCallProfile profile(fd);
+
+    // A strongly pure function gives the same result for the same arguments
+    CtfeMemoEntry *memo = NULL;
+    if (!thisarg && isMemoizable(fd, tf))
+    {
+        Expression *e = memoLookup(fd, &eargs, &memo);
+        if (e)
+            return e;
+    }
+
+    // Simple functions run on the bytecode VM. If it gives up, the call
+    // is interpreted again so that any error is reported as usual.
+    if (fd->ctfeVmCode && !thisarg)
+    {
+        Expression *e = ctfeVmInterpret(fd, &eargs);
+        if (e)
+        {
+            if (memo)
+                memoStore(memo, e);
+            return e;
+        }
+    }
+    ++CtfeStatus::numInterpretedCalls;
+
     // Now that we've evaluated all the arguments, we can start the frame
     // (this is the moment when the 'call' actually takes place).
     InterState istatex;
@@ -1063,6 +1734,8 @@ Expression *interpret(FuncDeclaration *fd, InterState *istate, Expressions *argu
         e = CTFEExp::cantexp;
     }
 
+    if (memo)
+        memoStore(memo, e);
     return e;
 }
 
@@ -2756,26 +3429,31 @@ public:
             return;
         }
 
-        /* Remove duplicate keys
+        /* Remove duplicate keys, keeping the last of each.
+         * Walk backwards, collecting the keys not seen yet.
          */
-        for (size_t i = 1; i < keysx->dim; i++)
+        if (keysx->dim > 1)
         {
-            Expression *ekey = (*keysx)[i - 1];
-            for (size_t j = i; j < keysx->dim; j++)
+            AssocArrayLiteralExp *seen = new AssocArrayLiteralExp(e->loc, new Expressions(), new Expressions());
+            for (size_t i = keysx->dim; i--; )
             {
-                Expression *ekey2 = (*keysx)[j];
-                int eq = ctfeEqual(e->loc, TOKequal, ekey, ekey2);
-                if (eq)       // if a match
+                Expression *ekey = (*keysx)[i];
+                if (findKeyInAA(e->loc, seen, ekey))
+                    continue;
+                seen->keys->push(ekey);
+                seen->values->push((*valuesx)[i]);
+            }
+            size_t dim = seen->keys->dim;
+            if (dim != keysx->dim)
+            {
+                keysx = new Expressions();
+                valuesx = new Expressions();
+                keysx->setDim(dim);
+                valuesx->setDim(dim);
+                for (size_t i = 0; i < dim; i++)
                 {
-                    // Remove ekey
-                    if (keysx == e->keys)
-                        keysx = (Expressions *)e->keys->copy();
-                    if (valuesx == e->values)
-                        valuesx = (Expressions *)e->values->copy();
-                    keysx->remove(i - 1);
-                    valuesx->remove(i - 1);
-                    i -= 1;         // redo the i'th iteration
-                    break;
+                    (*keysx)[i] = (*seen->keys)[dim - 1 - i];
+                    (*valuesx)[i] = (*seen->values)[dim - 1 - i];
                 }
             }
         }
@@ -2907,7 +3585,7 @@ public:
             return ae;
         }
         assert(argnum == arguments->dim - 1);
-        if (elemType->ty == Tchar || elemType->ty == Twchar || elemType->ty == Tdchar)
+        if (isCtfeNativeElement(elemType))
         {
             return createBlockDuplicatedStringLiteral(loc, newtype,
                 (unsigned)(elemType->defaultInitLiteral(loc)->toInteger()),
@@ -3476,6 +4154,7 @@ public:
             if (e->e1->type->ty != Tpointer)
             {
                 // ~= can create new values (see bug 6052)
+                Expression *appended = NULL;
                 if (e->op == TOKcatass)
                 {
                     // We need to dup it and repaint the type. For a dynamic array
@@ -3490,10 +4169,24 @@ public:
                         newval = paintTypeOntoLiteral(e->e2->type, newval);
                         newval = resolveSlice(newval);
                     }
-                }
-                oldval = resolveSlice(oldval);
 
-                newval = (*fp)(e->type, oldval, newval).copy();
+                    // Append in place where possible
+                    Type *t1b = e->e1->type->toBasetype();
+                    Type *t2b = e->e2->type->toBasetype();
+                    if (t1b->ty == Tarray)
+                    {
+                        bool isElement = (t2b->ty != Tarray && t2b->ty != Tsarray) ||
+                                         e->e2->type->implicitConvTo(t1b->nextOf());
+                        appended = ctfeAppend(e->loc, e->type, oldval, newval, isElement);
+                    }
+                }
+                if (appended)
+                    newval = appended;
+                else
+                {
+                    oldval = resolveSlice(oldval);
+                    newval = (*fp)(e->type, oldval, newval).copy();
+                }
             }
             else if (e->e2->type->isintegral() &&
                 (e->op == TOKaddass ||
@@ -3662,8 +4355,14 @@ public:
 
             if (oldlen != 0)    // Get the old array literal.
                 oldval = interpret(e1, istate);
-            newval = changeArrayLiteralLength(e->loc, (TypeArray *)t, oldval,
-                oldlen,  newlen).copy();
+            newval = NULL;
+            if (oldlen != 0 && newlen > oldlen)
+                newval = ctfeGrowArray(e->loc, (TypeArray *)t, oldval, newlen);
+            if (!newval)
+            {
+                newval = changeArrayLiteralLength(e->loc, (TypeArray *)t, oldval,
+                    oldlen,  newlen).copy();
+            }
         }
         else if (!isBlockAssignment)
         {
@@ -5990,6 +6689,11 @@ public:
         }
         assert(agg->op == TOKassocarrayliteral);
         AssocArrayLiteralExp *aae = (AssocArrayLiteralExp *)agg;
+        if (!findKeyInAA(e->loc, aae, index))
+        {
+            result = new IntegerExp(e->loc, 0, Type::tbool);
+            return;
+        }
         Expressions *keysx = aae->keys;
         Expressions *valuesx = aae->values;
         size_t removed = 0;
@@ -6007,6 +6711,7 @@ public:
         }
         valuesx->dim = valuesx->dim - removed;
         keysx->dim = keysx->dim - removed;
+        resetAAIndex(aae);
         result = new IntegerExp(e->loc, removed ? 1 : 0, Type::tbool);
     }
 
@@ -6054,6 +6759,8 @@ Expression *interpret(Statement *s, InterState *istate)
 {
     if (!s)
         return NULL;
+    if (global.params.ctfeStats && istate && istate->fd)
+        ++istate->fd->ctfeCode->numStatements;
     Interpreter v(istate, ctfeNeedNothing);
     s->accept(&v);
     return v.result;
@@ -6085,6 +6792,7 @@ Expression *scrubReturnValue(Loc loc, Expression *e)
         error(loc, "uninitialized variable '%s' cannot be returned from CTFE", ((VoidInitExp *)e)->var->toChars());
         return new ErrorExp();
     }
+    bool native = isCtfeNativeArray(e);
     e = resolveSlice(e);
     if (e->op == TOKstructliteral)
     {
@@ -6102,6 +6810,10 @@ Expression *scrubReturnValue(Loc loc, Expression *e)
     if (e->op == TOKstring)
     {
         ((StringExp *)e)->ownedByCtfe = false;
+
+        // Integer arrays stored natively become array literals again
+        if (native)
+            e = nativeArrayToLiteral((StringExp *)e);
     }
     if (e->op == TOKarrayliteral)
     {
@@ -21,6 +21,10 @@
 #include <assert.h>
 #include <time.h>       // for time() and ctime()
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "rmem.h"
 
 #include "lexer.h"
@@ -62,9 +66,173 @@ static void cmtable_init()
     }
 }
 
+/********************************************
+ * Scanning of runs of characters that need no special handling.
+ * Each of these returns a pointer to the first character at or after p
+ * that ends the run.  A run always ends at the 0 that terminates the
+ * source buffer, so the SSE2 versions, which only do aligned 16 byte
+ * loads, never read past the page that the terminating 0 is in.
+ * Characters >= 0x80 always end a run, as they have to be decoded.
+ */
+
+#if defined(__SSE2__)
+
+/* Bit i of the result is set if byte i of v is c.
+ */
+static inline unsigned matchChar(__m128i v, char c)
+{
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(c)));
+}
+
+/* Bit i of the result is set if byte i of v is in the range lo .. hi.
+ * lo and hi must be < 0x80.
+ */
+static inline unsigned matchRange(__m128i v, char lo, char hi)
+{
+    __m128i ge = _mm_cmpgt_epi8(v, _mm_set1_epi8(lo - 1));
+    __m128i le = _mm_cmplt_epi8(v, _mm_set1_epi8(hi + 1));
+    return _mm_movemask_epi8(_mm_and_si128(ge, le));
+}
+
+/* Bit i of the result is set if byte i of v ends a line, the
+ * source, or is >= 0x80.
+ */
+static inline unsigned matchLineEnd(__m128i v)
+{
+    return _mm_movemask_epi8(v) |       // >= 0x80
+        matchChar(v, '\n') | matchChar(v, '\r') |
+        matchChar(v, 0) | matchChar(v, 0x1A);
+}
+
+static inline unsigned spaceStops(__m128i v, int)
+{
+    return ~(matchChar(v, ' ') | matchChar(v, '\t')) & 0xFFFF;
+}
+
+static inline unsigned idcharStops(__m128i v, int)
+{
+    return ~(matchRange(v, 'a', 'z') | matchRange(v, 'A', 'Z') |
+             matchRange(v, '0', '9') | matchChar(v, '_')) & 0xFFFF;
+}
+
+static inline unsigned lineCommentStops(__m128i v, int)
+{
+    return matchLineEnd(v);
+}
+
+static inline unsigned blockCommentStops(__m128i v, int)
+{
+    return matchLineEnd(v) | matchChar(v, '/');
+}
+
+static inline unsigned stringStops(__m128i v, int tc)
+{
+    return matchLineEnd(v) | matchChar(v, tc) | matchChar(v, '\\');
+}
+
+static inline unsigned wysiwygStops(__m128i v, int tc)
+{
+    return matchLineEnd(v) | matchChar(v, tc);
+}
+
+/* Return pointer to the first character at or after p for which
+ * stops() sets the bit.
+ */
+static inline const utf8_t *scanRun(const utf8_t *p,
+        unsigned (*stops)(__m128i, int), int arg)
+{
+    size_t misalign = (size_t)p & 15;
+    const __m128i *b = (const __m128i *)(p - misalign);
+    unsigned mask = stops(_mm_load_si128(b), arg) >> misalign;
+    if (mask)
+        return p + __builtin_ctz(mask);
+    while (1)
+    {
+        b++;
+        mask = stops(_mm_load_si128(b), arg);
+        if (mask)
+            return (const utf8_t *)b + __builtin_ctz(mask);
+    }
+}
+
+#endif
+
+/* Skip ' ' and '\t'.
+ */
+static inline const utf8_t *skipSpaces(const utf8_t *p)
+{
+#if defined(__SSE2__)
+    return scanRun(p, spaceStops, 0);
+#else
+    while (*p == ' ' || *p == '\t')
+        p++;
+    return p;
+#endif
+}
+
+/* Skip ASCII identifier characters.
+ */
+static inline const utf8_t *skipIdchars(const utf8_t *p)
+{
+#if defined(__SSE2__)
+    return scanRun(p, idcharStops, 0);
+#else
+    while (isidchar(*p))
+        p++;
+    return p;
+#endif
+}
+
+/* Skip the body of a // comment up to the end of line.
+ */
+static inline const utf8_t *skipLineComment(const utf8_t *p)
+{
+#if defined(__SSE2__)
+    return scanRun(p, lineCommentStops, 0);
+#else
+    while (*p != '\n' && *p != '\r' && *p != 0 && *p != 0x1A && !(*p & 0x80))
+        p++;
+    return p;
+#endif
+}
+
+/* Skip the body of a block comment up to the next '/' or end of line.
+ */
+static inline const utf8_t *skipBlockComment(const utf8_t *p)
+{
+#if defined(__SSE2__)
+    return scanRun(p, blockCommentStops, 0);
+#else
+    while (*p != '/' && *p != '\n' && *p != '\r' && *p != 0 && *p != 0x1A && !(*p & 0x80))
+        p++;
+    return p;
+#endif
+}
+
+/* Skip characters of a string literal ending with tc that are copied
+ * into the string unchanged.  If escapes is set, backslash escape
+ * sequences also end the run.
+ */
+static inline const utf8_t *skipStringChars(const utf8_t *p, int tc, bool escapes)
+{
+#if defined(__SSE2__)
+    return scanRun(p, escapes ? stringStops : wysiwygStops, tc);
+#else
+    while (*p != tc && !(escapes && *p == '\\') &&
+           *p != '\n' && *p != '\r' && *p != 0 && *p != 0x1A && !(*p & 0x80))
+        p++;
+    return p;
+#endif
+}
+
+/* Values of __DATE__, __TIME__ and __TIMESTAMP__, set by initLexer().
+ */
+static char datestr[11+1];
+static char timestr[8+1];
+static char timestampstr[24+1];
+
 /*************************** Lexer ********************************************/
 
-OutBuffer Lexer::stringbuffer;
 
 Lexer::Lexer(const char *filename,
         const utf8_t *base, size_t begoffset, size_t endoffset,
@@ -327,7 +495,7 @@ void Lexer::scan(Token *t)
             case '\t':
             case '\v':
             case '\f':
-                p++;
+                p = skipSpaces(p + 1);
                 continue;                       // skip white space
 
             case '\r':
@@ -401,6 +569,7 @@ void Lexer::scan(Token *t)
             case_ident:
             {   utf8_t c;
 
+                p = skipIdchars(p + 1) - 1;
                 while (1)
                 {
                     c = *++p;
@@ -423,31 +592,14 @@ void Lexer::scan(Token *t)
                 anyToken = 1;
                 if (*t->ptr == '_')     // if special identifier token
                 {
-                    static bool initdone = false;
-                    static char date[11+1];
-                    static char time[8+1];
-                    static char timestamp[24+1];
-
-                    if (!initdone)       // lazy evaluation
-                    {
-                        initdone = true;
-                        time_t ct;
-                        ::time(&ct);
-                        char *p = ctime(&ct);
-                        assert(p);
-                        sprintf(&date[0], "%.6s %.4s", p + 4, p + 20);
-                        sprintf(&time[0], "%.8s", p + 11);
-                        sprintf(&timestamp[0], "%.24s", p);
-                    }
-
                     if (id == Id::DATE)
                     {
-                        t->ustring = (utf8_t *)date;
+                        t->ustring = (utf8_t *)datestr;
                         goto Lstr;
                     }
                     else if (id == Id::TIME)
                     {
-                        t->ustring = (utf8_t *)time;
+                        t->ustring = (utf8_t *)timestr;
                         goto Lstr;
                     }
                     else if (id == Id::VENDOR)
@@ -457,7 +609,7 @@ void Lexer::scan(Token *t)
                     }
                     else if (id == Id::TIMESTAMP)
                     {
-                        t->ustring = (utf8_t *)timestamp;
+                        t->ustring = (utf8_t *)timestampstr;
                      Lstr:
                         t->value = TOKstring;
                         t->postfix = 0;
@@ -514,7 +666,8 @@ void Lexer::scan(Token *t)
                         while (1)
                         {
                             while (1)
-                            {   utf8_t c = *p;
+                            {   p = skipBlockComment(p);
+                                utf8_t c = *p;
                                 switch (c)
                                 {
                                     case '/':
@@ -569,7 +722,8 @@ void Lexer::scan(Token *t)
                     case '/':           // do // style comments
                         startLoc = loc();
                         while (1)
-                        {   utf8_t c = *++p;
+                        {   p = skipLineComment(p + 1);
+                            utf8_t c = *p;
                             switch (c)
                             {
                                 case '\n':
@@ -1127,6 +1281,12 @@ TOK Lexer::wysiwygStringConstant(Token *t, int tc)
     stringbuffer.reset();
     while (1)
     {
+        const utf8_t *q = skipStringChars(p, tc, false);
+        if (q != p)
+        {
+            stringbuffer.write(p, q - p);
+            p = q;
+        }
         c = *p++;
         switch (c)
         {
@@ -1484,6 +1644,12 @@ TOK Lexer::escapeStringConstant(Token *t, int wide)
     stringbuffer.reset();
     while (1)
     {
+        const utf8_t *q = skipStringChars(p, '"', true);
+        if (q != p)
+        {
+            stringbuffer.write(p, q - p);
+            p = q;
+        }
         c = *p++;
         switch (c)
         {
@@ -2458,6 +2624,16 @@ void Lexer::initLexer()
 {
     cmtable_init();
 
+    // Computed here rather than lazily in scan(), which may run on
+    // several threads at once.
+    time_t ct;
+    ::time(&ct);
+    char *p = ctime(&ct);
+    assert(p);
+    sprintf(&datestr[0], "%.6s %.4s", p + 4, p + 20);
+    sprintf(&timestr[0], "%.8s", p + 11);
+    sprintf(&timestampstr[0], "%.24s", p);
+
     Identifier::initTable();
     Token::initTokens();
 
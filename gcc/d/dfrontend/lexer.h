@@ -26,7 +26,7 @@ class Identifier;
 class Lexer
 {
 public:
-    static OutBuffer stringbuffer;
+    OutBuffer stringbuffer;     // scratch space for building literals
 
     Loc scanloc;                // for error messages
 
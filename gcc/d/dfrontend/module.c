@@ -11,6 +11,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
 #include "mars.h"
@@ -25,12 +26,21 @@
 #include "lexer.h"
 #include "attrib.h"
 #include "target.h"
+#include "declaration.h"
+#include "aggregate.h"
+#include "enum.h"
+#include "template.h"
+#include "staticassert.h"
+#include "visitor.h"
+#include "aav.h"
 
 AggregateDeclaration *Module::moduleinfo;
 
 Module *Module::rootModule;
 DsymbolTable *Module::modules;
 Modules Module::amodules;
+size_t Module::numLazyMembers;
+size_t Module::numLazyAnalyzed;
 
 Dsymbols Module::deferred; // deferred Dsymbol's needing semantic() run on them
 Dsymbols Module::deferred3;
@@ -63,6 +73,8 @@ Module::Module(const char *filename, Identifier *ident, int doDocComment, int do
     searchCacheIdent = NULL;
     searchCacheSymbol = NULL;
     searchCacheFlags = 0;
+    lazyMembers = NULL;
+    deferMembers = false;
     decldefs = NULL;
     massert = NULL;
     munittest = NULL;
@@ -94,6 +106,10 @@ Module::Module(const char *filename, Identifier *ident, int doDocComment, int do
     nameoffset = 0;
     namelen = 0;
 
+    preparsed = false;
+    parseErrors = false;
+    parseDiagnostics = NULL;
+
     srcfilename = FileName::defaultExt(filename, global.mars_ext);
 
     if (global.run_noext && global.params.run &&
@@ -191,14 +207,20 @@ const char *Module::kind()
     return "module";
 }
 
-Module *Module::load(Loc loc, Identifiers *packages, Identifier *ident)
-{
-    //printf("Module::load(ident = '%s')\n", ident->toChars());
+/* Modules created and read by Module::prefetch(), keyed by the file
+ * name Module::load() would look for.
+ */
+static StringTable *prefetched;
 
-    // Build module filename by turning:
-    //  foo.bar.baz
-    // into:
-    //  foo\bar\baz
+/*************************************
+ * Build module filename by turning:
+ *  foo.bar.baz
+ * into:
+ *  foo\bar\baz
+ */
+
+static char *moduleFileName(Identifiers *packages, Identifier *ident)
+{
     char *filename = ident->toChars();
     if (packages && packages->dim)
     {
@@ -218,18 +240,49 @@ Module *Module::load(Loc loc, Identifiers *packages, Identifier *ident)
         buf.writeByte(0);
         filename = (char *)buf.extractData();
     }
+    return filename;
+}
 
-    Module *m = new Module(filename, ident, 0, 0);
-    m->loc = loc;
+Module *Module::load(Loc loc, Identifiers *packages, Identifier *ident)
+{
+    //printf("Module::load(ident = '%s')\n", ident->toChars());
 
-    /* Look for the source file
+    char *filename = moduleFileName(packages, ident);
+    Module *m = NULL;
+
+    /* See if the module was already read, and perhaps parsed,
+     * by Module::prefetch()
      */
-    const char *result = lookForSourceFile(filename);
-    if (result)
-        m->srcfile = new File(result);
+    if (prefetched)
+    {
+        StringValue *sv = prefetched->lookup(filename, strlen(filename));
+        if (sv && sv->ptrvalue)
+        {
+            m = (Module *)sv->ptrvalue;
+            sv->ptrvalue = NULL;        // only hand it out once
+            m->loc = loc;
 
-    if (!m->read(loc))
-        return NULL;
+            /* If reading it ahead failed, read it again to get the error
+             */
+            if (!m->preparsed && !m->srcfile->buffer && !m->read(loc))
+                return NULL;
+        }
+    }
+
+    if (!m)
+    {
+        m = new Module(filename, ident, 0, 0);
+        m->loc = loc;
+
+        /* Look for the source file
+         */
+        const char *result = lookForSourceFile(filename);
+        if (result)
+            m->srcfile = new File(result);
+
+        if (!m->read(loc))
+            return NULL;
+    }
 
     if (global.params.verbose)
     {
@@ -252,10 +305,44 @@ Module *Module::load(Loc loc, Identifiers *packages, Identifier *ident)
     return m;
 }
 
+/*************************************
+ * Create the module that Module::load(loc, packages, ident) would load,
+ * so that it can be read and parsed ahead of time with parseAhead().
+ * Module::load() later picks it up instead of creating it again.
+ * Unlike load(), nothing is reported if the module cannot be found.
+ * Returns:
+ *      the module, or NULL if it cannot be found or was already prefetched
+ */
+
+Module *Module::prefetch(Loc loc, Identifiers *packages, Identifier *ident)
+{
+    char *filename = moduleFileName(packages, ident);
+
+    if (!prefetched)
+    {
+        prefetched = new StringTable();
+        prefetched->_init();
+    }
+    StringValue *sv = prefetched->insert(filename, strlen(filename));
+    if (!sv)
+        return NULL;            // already seen
+
+    const char *result = lookForSourceFile(filename);
+    if (!result)
+        return NULL;
+
+    Module *m = new Module(filename, ident, 0, 0);
+    m->loc = loc;
+    m->srcfile = new File(result);
+
+    sv->ptrvalue = (char *)m;
+    return m;
+}
+
 bool Module::read(Loc loc)
 {
     //printf("Module::read('%s') file '%s'\n", toChars(), srcfile->toChars());
-    if (srcfile->read())
+    if (srcfile->mmread())
     {
         if (!strcmp(srcfile->toChars(), "object.d"))
         {
@@ -332,8 +419,22 @@ void Module::parse()
 
     isPackageFile = (strcmp(srcfile->name->name(), "package.d") == 0);
 
-    utf8_t *buf = (utf8_t *)srcfile->buffer;
-    size_t buflen = srcfile->len;
+    utf8_t *buf;
+    size_t buflen;
+
+    if (preparsed)
+    {
+        /* Lexing and parsing were already done by parseAhead(), report
+         * what it found at the point a serial parse would have.
+         */
+        emitDeferredDiagnostics(parseDiagnostics);
+        if (parseErrors)
+            ++global.errors;
+        goto Linsert;
+    }
+
+    buf = (utf8_t *)srcfile->buffer;
+    buflen = srcfile->len;
 
     if (buflen >= 2)
     {
@@ -517,11 +618,14 @@ void Module::parse()
             ++global.errors;
     }
 
-    if (srcfile->ref == 0)
+    if (srcfile->ref == 2)
+        srcfile->unmap();
+    else if (srcfile->ref == 0)
         ::free(srcfile->buffer);
     srcfile->buffer = NULL;
     srcfile->len = 0;
 
+Linsert:
     /* The symbol table into which the module is to be inserted.
      */
     DsymbolTable *dst;
@@ -628,6 +732,60 @@ void Module::parse()
     }
 }
 
+/*************************************
+ * Read the source, if not done already, then lex and parse it without
+ * touching any state shared with other modules, so that this can run
+ * on a worker thread.  parse() must still be called afterwards, on the
+ * main thread, to emit diagnostics and insert the module into the
+ * symbol table.  Only plain UTF-8 D source is handled here.
+ * Returns:
+ *      true if the module was parsed
+ */
+
+bool Module::parseAhead()
+{
+    if (preparsed)
+        return false;
+    if (!srcfile->buffer && srcfile->mmread())
+        return false;           // load() will report the error
+
+    utf8_t *buf = (utf8_t *)srcfile->buffer;
+    size_t buflen = srcfile->len;
+
+    if (buflen >= 3 && buf[0] == 0xEF && buf[1] == 0xBB && buf[2] == 0xBF)
+    {
+        // UTF-8 BOM
+        buf += 3;
+        buflen -= 3;
+    }
+    else if (buflen >= 2 && (buf[0] == 0 || buf[1] == 0 || buf[0] >= 0x80))
+        return false;           // UTF-16/32, or an error parse() will report
+
+    if (buflen >= 4 && memcmp(buf, "Ddoc", 4) == 0)
+        return false;
+
+    parseDiagnostics = startDeferringDiagnostics();
+    {
+        Parser p(this, buf, buflen, docfile != NULL);
+        p.nextToken();
+        members = p.parseModule();
+        md = p.md;
+        numlines = p.scanloc.linnum;
+        parseErrors = p.errors;
+    }
+    stopDeferringDiagnostics();
+
+    if (srcfile->ref == 2)
+        srcfile->unmap();
+    else if (srcfile->ref == 0)
+        ::free(srcfile->buffer);
+    srcfile->buffer = NULL;
+    srcfile->len = 0;
+
+    preparsed = true;
+    return true;
+}
+
 void Module::importAll(Scope *prevsc)
 {
     //printf("+Module::importAll(this = %p, '%s'): parent = %p\n", this, toChars(), parent);
@@ -700,6 +858,158 @@ void Module::importAll(Scope *prevsc)
     sc->pop();          // 2 pops because Scope::createGlobal() created 2
 }
 
+/*******************************************
+ * Return true if the semantic of the declarations of this module can
+ * wait until they are looked up.  The compiler finds some symbols of
+ * object and the runtime without looking them up, so those are never
+ * deferred, nor are the modules being compiled.
+ */
+
+bool Module::canDeferSemantic()
+{
+    if (isRoot())
+        return false;
+    Dsymbol *top = this;
+    while (top->parent)
+        top = top->parent;
+    if (top == this && ident == Id::object)
+        return false;
+    const char *name = top->ident->toChars();
+    return strcmp(name, "core") != 0 && strcmp(name, "gcc") != 0;
+}
+
+/* Return true if the members of an aggregate declare a static constructor,
+ * static destructor or static assert, which must be analyzed even if the
+ * aggregate is never looked up.  Both branches of conditional declarations
+ * are searched, and mixins count as they may declare anything.
+ */
+static bool hasEagerMembers(Dsymbols *members)
+{
+    class EagerMembers : public Visitor
+    {
+    public:
+        bool result;
+
+        EagerMembers() : result(false) {}
+
+        void visitMembers(Dsymbols *members)
+        {
+            for (size_t i = 0; members && i < members->dim && !result; i++)
+                (*members)[i]->accept(this);
+        }
+
+        void visit(Dsymbol *) {}
+        void visit(StaticAssert *) { result = true; }
+        void visit(StaticCtorDeclaration *) { result = true; }
+        void visit(StaticDtorDeclaration *) { result = true; }
+        void visit(CompileDeclaration *) { result = true; }
+        void visit(TemplateMixin *) { result = true; }
+
+        void visit(AttribDeclaration *s)
+        {
+            visitMembers(s->decl);
+        }
+
+        void visit(ConditionalDeclaration *s)
+        {
+            visitMembers(s->decl);
+            visitMembers(s->elsedecl);
+        }
+
+        void visit(AggregateDeclaration *s)
+        {
+            visitMembers(s->members);
+        }
+    };
+
+    EagerMembers v;
+    v.visitMembers(members);
+    return v.result;
+}
+
+/* Only declarations that have no effect until something refers to them
+ * by name are deferred.  Imports, static constructors, static asserts,
+ * templates and mixins keep being analyzed in order, as do aggregates
+ * that contain any of the first three.
+ */
+static bool isLazyMember(Dsymbol *s)
+{
+    if (FuncDeclaration *fd = s->isFuncDeclaration())
+    {
+        return !fd->isStaticCtorDeclaration() &&
+               !fd->isStaticDtorDeclaration() &&
+               !fd->isUnitTestDeclaration();
+    }
+    if (s->isVarDeclaration())
+        return true;
+    if (AggregateDeclaration *ad = s->isAggregateDeclaration())
+        return !hasEagerMembers(ad->members);
+    if (EnumDeclaration *ed = s->isEnumDeclaration())
+        return ed->ident != NULL;   // anonymous enum members are looked up directly
+    return false;
+}
+
+/*******************************************
+ * While the members of this module go through semantic, record s,
+ * declared at the top level or in an attribute block with scope sc,
+ * instead of analyzing it if it can wait until it is looked up.
+ */
+
+bool Module::deferSemantic(Dsymbol *s, Scope *sc)
+{
+    if (!deferMembers || !isLazyMember(s))
+        return false;
+    sc->setNoFree();
+    *dmd_aaGet(&lazyMembers, (void *)s) = (void *)sc;
+    numLazyMembers++;
+    return true;
+}
+
+bool Module::isLazyPending(Dsymbol *s)
+{
+    return lazyMembers && dmd_aaGetRvalue(lazyMembers, (void *)s) != NULL;
+}
+
+/* Functions and templates are looked up by the first of their overloads,
+ * so return the next one of s, or NULL.
+ */
+static Dsymbol *nextOverload(Dsymbol *s)
+{
+    if (FuncDeclaration *fd = s->isFuncDeclaration())
+        return fd->overnext;
+    if (TemplateDeclaration *td = s->isTemplateDeclaration())
+        return td->overnext ? (Dsymbol *)td->overnext : (Dsymbol *)td->funcroot;
+    return NULL;
+}
+
+/*******************************************
+ * A lookup found s.  If s, or another overload of it, is a member of
+ * this module whose semantic was deferred, run it now, catching up
+ * with the passes the module has already been through.
+ */
+
+void Module::lazySemantic(Dsymbol *s)
+{
+    size_t n = 0;
+    for (Dsymbol *sx = s; sx; sx = nextOverload(sx))
+    {
+        if (n++ && sx == s)
+            break;                  // went round a unified overload list
+        Scope *sc = lazyMembers ? (Scope *)dmd_aaGetRvalue(lazyMembers, (void *)sx) : NULL;
+        if (!sc)
+            continue;
+        *dmd_aaGet(&lazyMembers, (void *)sx) = NULL;
+        numLazyAnalyzed++;
+
+        sx->semantic(sc);
+        runDeferredSemantic();
+        if (semanticRun >= PASSsemantic2)
+            sx->semantic2(sc);
+        if (semanticRun >= PASSsemantic3)
+            sx->semantic3(sc);
+    }
+}
+
 void Module::semantic()
 {
     if (semanticRun != PASSinit)
@@ -719,16 +1029,25 @@ void Module::semantic()
 
     //printf("Module = %p, linkage = %d\n", sc->scopesym, sc->linkage);
 
+    // With -flazy-imports, declarations of imported modules wait for
+    // the first lookup that finds them, see lazySemantic().
+    deferMembers = global.params.lazySemantic && scope && canDeferSemantic();
+
     // Pass 1 semantic routines: do public side of the definition
     for (size_t i = 0; i < members->dim; i++)
     {
         Dsymbol *s = (*members)[i];
 
+        if (deferSemantic(s, sc))
+            continue;
+
         //printf("\tModule('%s'): '%s'.semantic()\n", toChars(), s->toChars());
         s->semantic(sc);
         runDeferredSemantic();
     }
 
+    deferMembers = false;
+
     if (userAttribDecl)
     {
         userAttribDecl->semantic(sc);
@@ -760,6 +1079,8 @@ void Module::semantic2()
     for (size_t i = 0; i < members->dim; i++)
     {
         Dsymbol *s = (*members)[i];
+        if (isLazyPending(s))
+            continue;
         s->semantic2(sc);
     }
 
@@ -791,6 +1112,8 @@ void Module::semantic3()
     for (size_t i = 0; i < members->dim; i++)
     {
         Dsymbol *s = (*members)[i];
+        if (isLazyPending(s))
+            continue;
         //printf("Module %s: %s.semantic3()\n", toChars(), s->toChars());
         s->semantic3(sc);
     }
@@ -825,7 +1148,10 @@ Dsymbol *Module::search(Loc loc, Identifier *ident, int flags)
 
     //printf("%s Module::search('%s', flags = %d) insearch = %d\n", toChars(), ident->toChars(), flags, insearch);
     if (insearch)
+    {
+        numSearchCycles++;
         return NULL;
+    }
     if (searchCacheIdent == ident && searchCacheFlags == flags)
     {
         //printf("%s Module::search('%s', flags = %d) insearch = %d searchCacheSymbol = %s\n",
@@ -839,6 +1165,9 @@ Dsymbol *Module::search(Loc loc, Identifier *ident, int flags)
     Dsymbol *s = ScopeDsymbol::search(loc, ident, flags);
     insearch = 0;
 
+    if (s && lazyMembers)
+        lazySemantic(s);
+
     if (errors == global.errors)
     {
         // Bugzilla 10752: We can cache the result only when it does not cause
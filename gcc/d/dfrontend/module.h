@@ -25,6 +25,7 @@ struct Macro;
 struct Escape;
 class VarDeclaration;
 class Library;
+struct DeferredDiagnostics;
 
 enum PKG
 {
@@ -92,6 +93,11 @@ public:
     Dsymbol *searchCacheSymbol; // cached value of search
     int searchCacheFlags;       // cached flags
 
+    AA *lazyMembers;            // members whose semantic waits for a lookup, and their scope
+    bool deferMembers;          // set while semantic() may defer members, see deferSemantic()
+    static size_t numLazyMembers;       // members deferred by -flazy-imports
+    static size_t numLazyAnalyzed;      // of those, the ones a lookup reached
+
     Module *importedFrom;       // module from command line we're imported from,
                                 // i.e. a module that will be taken all the
                                 // way to an object file
@@ -114,16 +120,22 @@ public:
     size_t nameoffset;          // offset of module name from start of ModuleInfo
     size_t namelen;             // length of module name in characters
 
+    bool preparsed;             // members already parsed by parseAhead()
+    bool parseErrors;           // parseAhead() found errors
+    DeferredDiagnostics *parseDiagnostics; // diagnostics raised by parseAhead()
+
     Module(const char *arg, Identifier *ident, int doDocComment, int doHdrGen);
     static Module* create(const char *arg, Identifier *ident, int doDocComment, int doHdrGen);
 
     static Module *load(Loc loc, Identifiers *packages, Identifier *ident);
+    static Module *prefetch(Loc loc, Identifiers *packages, Identifier *ident);
 
     const char *kind();
     File *setOutfile(const char *name, const char *dir, const char *arg, const char *ext);
     void setDocfile();
     bool read(Loc loc); // read file, returns 'true' if succeed, 'false' otherwise.
     void parse();       // syntactic parse
+    bool parseAhead();  // syntactic parse only, safe to run on another thread
     void importAll(Scope *sc);
     void semantic();    // semantic analysis
     void semantic2();   // pass 2 semantic analysis
@@ -142,6 +154,10 @@ public:
     bool isRoot() { return this->importedFrom == this; }
                                 // true if the module source file is directly
                                 // listed in command line.
+    bool canDeferSemantic();
+    bool deferSemantic(Dsymbol *s, Scope *sc);
+    bool isLazyPending(Dsymbol *s);
+    void lazySemantic(Dsymbol *s);
 
     // Back end
 
@@ -156,7 +156,7 @@ const char *Type::kind()
 
 Type *Type::copy()
 {
-    Type *t = (Type *)mem.xmalloc(sizeTy[ty]);
+    Type *t = (Type *)allocmemory(sizeTy[ty], MEMtype);
     memcpy((void*)t, (void*)this, sizeTy[ty]);
     return t;
 }
@@ -343,7 +343,7 @@ Type *Type::trySemantic(Loc loc, Scope *sc)
 Type *Type::nullAttributes()
 {
     unsigned sz = sizeTy[ty];
-    Type *t = (Type *)mem.xmalloc(sz);
+    Type *t = (Type *)allocmemory(sz, MEMtype);
     memcpy((void*)t, (void*)this, sz);
     // t->mod = NULL;  // leave mod unchanged
     t->deco = NULL;
@@ -624,6 +624,9 @@ Type *Type::sharedWildConstOf()
 
 void Type::fixTo(Type *t)
 {
+    // The parallel parser can construct types on several threads.
+    Port::lock();
+
     // If fixing this: immutable(T*) by t: immutable(T)*,
     // cache t to this->xto won't break transitivity.
     Type *mto = NULL;
@@ -704,6 +707,7 @@ void Type::fixTo(Type *t)
 
     check();
     t->check();
+    Port::unlock();
     //printf("fixTo: %s, %s\n", toChars(), t->toChars());
 }
 
@@ -923,6 +927,9 @@ Type *Type::makeMutable()
 
 Type *Type::addSTC(StorageClass stc)
 {
+    // Called by the parser, which can run on several threads; hold the
+    // lock while the cto/ito shortcuts are read and filled in.
+    Port::lock();
     Type *t = this;
     if (t->isImmutable())
         ;
@@ -984,6 +991,7 @@ Type *Type::addSTC(StorageClass stc)
             }
         }
     }
+    Port::unlock();
     return t;
 }
 
@@ -1062,6 +1070,7 @@ Type *Type::addMod(MOD mod)
 {
     /* Add anything to immutable, and it remains immutable
      */
+    Port::lock();
     Type *t = this;
     if (!t->isImmutable())
     {
@@ -1155,6 +1164,7 @@ Type *Type::addMod(MOD mod)
                 assert(0);
         }
     }
+    Port::unlock();
     return t;
 }
 
@@ -1649,6 +1659,7 @@ Type *Type::merge()
     //printf("merge(%s)\n", toChars());
     Type *t = this;
     assert(t);
+    Port::lock();
     if (!deco)
     {
         OutBuffer buf;
@@ -1674,6 +1685,7 @@ Type *Type::merge()
             //printf("new value, deco = '%s' %p\n", t->deco, t->deco);
         }
     }
+    Port::unlock();
     return t;
 }
 
@@ -5346,7 +5358,7 @@ Type *TypeFunction::semantic(Loc loc, Scope *sc)
         tf->parameters = parameters->copy();
         for (size_t i = 0; i < parameters->dim; i++)
         {
-            Parameter *p = (Parameter *)mem.xmalloc(sizeof(Parameter));
+            Parameter *p = (Parameter *)allocmemory(sizeof(Parameter));
             memcpy((void *)p, (void *)(*parameters)[i], sizeof(Parameter));
             (*tf->parameters)[i] = p;
         }
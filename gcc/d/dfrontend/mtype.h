@@ -127,6 +127,8 @@ typedef unsigned char MOD;
 class Type : public RootObject
 {
 public:
+    DECLARE_ALLOCATOR(MEMtype)
+
     TY ty;
     MOD mod;  // modifiers MODxxxx
     char *deco;
@@ -11,6 +11,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "rmem.h"
+
 #if defined(__has_feature)
 #if __has_feature(address_sanitizer)
 #define USE_ASAN_NEW_DELETE
@@ -21,8 +23,6 @@
 
 #if 1
 
-void *allocmemory(size_t m_size);
-
 void * operator new(size_t m_size)
 {
     return allocmemory(m_size);
@@ -10,6 +10,7 @@
  */
 
 #include "mars.h"
+#include "aggregate.h"
 #include "init.h"
 #include "visitor.h"
 #include "expression.h"
@@ -21,6 +22,7 @@
 #include "tokens.h"
 
 bool walkPostorder(Expression *e, StoppableVisitor *v);
+bool checkEscapingSiblings(FuncDeclaration *f, FuncDeclaration *outerFunc, void *p = NULL);
 
 void FuncDeclaration::printGCUsage(Loc loc, const char* warn)
 {
@@ -34,6 +36,67 @@ void FuncDeclaration::printGCUsage(Loc loc, const char* warn)
     }
 }
 
+/**************************************
+ * Print why the closure of this function has to be allocated
+ * on the GC heap, and the variables it holds.
+ * Only to be called if needsClosure() returned true.
+ */
+
+void FuncDeclaration::printClosureUsage()
+{
+    if (!global.params.closureReport)
+        return;
+
+    Module *m = getModule();
+    if (!m || !m->isRoot())
+        return;
+
+    /* Find the first escaping function in the same way needsClosure() does.
+     */
+    OutBuffer why;
+    if (requiresClosure)
+        why.writestring("a function nested in it escapes with a reference to its frame");
+    for (size_t i = 0; i < closureVars.dim && !why.offset; i++)
+    {
+        VarDeclaration *v = closureVars[i];
+        for (size_t j = 0; j < v->nestedrefs.dim && !why.offset; j++)
+        {
+            FuncDeclaration *f = v->nestedrefs[j];
+            for (Dsymbol *s = f; s && s != this; s = s->parent)
+            {
+                FuncDeclaration *fx = s->isFuncDeclaration();
+                if (!fx)
+                    continue;
+                if (AggregateDeclaration *ad = fx->isThis())
+                {
+                    why.printf("'%s' is a member of %s '%s'", fx->toChars(), ad->kind(), ad->toChars());
+                    break;
+                }
+                if (fx->tookAddressOf)
+                {
+                    why.printf("the address of '%s' escapes", fx->toChars());
+                    break;
+                }
+                if (checkEscapingSiblings(fx, this))
+                {
+                    why.printf("'%s' is called by a nested function that escapes", fx->toChars());
+                    break;
+                }
+            }
+        }
+    }
+    if (!why.offset)
+        why.writestring("it returns a type nested in it");
+
+    fprintf(global.stdmsg, "%s: closure: '%s' allocates a closure with the GC because %s\n",
+        loc.toChars(), toPrettyChars(), why.peekString());
+    for (size_t i = 0; i < closureVars.dim; i++)
+    {
+        VarDeclaration *v = closureVars[i];
+        fprintf(global.stdmsg, "%s: closure:     '%s' is captured\n", v->loc.toChars(), v->toChars());
+    }
+}
+
 /**************************************
  * Look for GC-allocations
  */
@@ -85,6 +148,8 @@ public:
     {
         if (e->type->ty != Tarray || !e->elements || !e->elements->dim)
             return;
+        if (e->onstack)
+            return;     // allocated on the stack
 
         if (f->setGC())
         {
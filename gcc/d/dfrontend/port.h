@@ -59,6 +59,13 @@ struct Port
     static longdouble strtof(const char *p, char **endp);
     static longdouble strtod(const char *p, char **endp);
     static longdouble strtold(const char *p, char **endp);
+
+    // Serialize access to tables shared by the threads of the parallel
+    // parser.  Does nothing unless 'threaded' is set.  The lock is
+    // recursive.
+    static bool threaded;
+    static void lock();
+    static void unlock();
 };
 
 #endif
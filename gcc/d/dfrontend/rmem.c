@@ -124,40 +124,158 @@ void Mem::error()
 // causes the actual memory block to be larger than 1Mb otherwise.
 #define CHUNK_SIZE (256 * 4096 - 64)
 
-static size_t heapleft = 0;
-static void *heapp;
+// Each new chunk is twice the size of the last one, up to this limit, so that
+// large compilations do not go back to malloc every megabyte.
+#define CHUNK_SIZE_MAX (64 * 256 * 4096 - 64)
 
-void *allocmemory(size_t m_size)
+struct AllocStats
 {
+    size_t count;       // number of allocations
+    size_t bytes;       // bytes requested, after rounding for alignment
+};
+
+struct Heap
+{
+    size_t heapleft;
+    void *heapp;
+    size_t chunksize;           // size of the next chunk, 0 means CHUNK_SIZE
+
+    AllocStats allocstats[MEMmax];
+    size_t totalbytes;          // sum of allocstats[].bytes
+    size_t nchunks;             // number of chunks malloc'd
+    size_t chunkbytes;          // total size of those chunks
+    size_t largebytes;          // allocations too big for a chunk
+    size_t wastedbytes;         // unused tails of retired chunks
+};
+
+// Each thread bump-allocates from its own chunk, so the parallel
+// parser needs no locking here.
+static THREAD_LOCAL Heap heap;
+
+// Statistics of threads that have finished.
+static Heap mergedheap;
+
+void *allocmemory(size_t m_size, MEMKIND kind)
+{
+    Heap *h = &heap;
+
     // 16 byte alignment is better (and sometimes needed) for doubles
     m_size = (m_size + 15) & ~15;
 
+    h->allocstats[kind].count++;
+    h->allocstats[kind].bytes += m_size;
+    h->totalbytes += m_size;
+
     // The layout of the code is selected so the most common case is straight through
-    if (m_size <= heapleft)
+    if (m_size <= h->heapleft)
     {
      L1:
-        heapleft -= m_size;
-        void *p = heapp;
-        heapp = (void *)((char *)heapp + m_size);
+        h->heapleft -= m_size;
+        void *p = h->heapp;
+        h->heapp = (void *)((char *)h->heapp + m_size);
         return p;
     }
 
-    if (m_size > CHUNK_SIZE)
+    if (!h->chunksize)
+        h->chunksize = CHUNK_SIZE;
+
+    if (m_size > h->chunksize)
     {
         void *p = malloc(m_size);
         if (p)
+        {
+            h->largebytes += m_size;
             return p;
+        }
         printf("Error: out of memory\n");
         exit(EXIT_FAILURE);
         return p;
     }
 
-    heapleft = CHUNK_SIZE;
-    heapp = malloc(CHUNK_SIZE);
-    if (!heapp)
+    h->wastedbytes += h->heapleft;
+    h->heapleft = h->chunksize;
+    h->heapp = malloc(h->chunksize);
+    if (!h->heapp)
     {
         printf("Error: out of memory\n");
         exit(EXIT_FAILURE);
     }
+    h->nchunks++;
+    h->chunkbytes += h->chunksize;
+    if (h->chunksize < CHUNK_SIZE_MAX)
+        h->chunksize = (h->chunksize + 64) * 2 - 64;
     goto L1;
 }
+
+static void mergeheap(Heap *to, Heap *from)
+{
+    for (size_t i = 0; i < MEMmax; i++)
+    {
+        to->allocstats[i].count += from->allocstats[i].count;
+        to->allocstats[i].bytes += from->allocstats[i].bytes;
+    }
+    to->totalbytes += from->totalbytes;
+    to->nchunks += from->nchunks;
+    to->chunkbytes += from->chunkbytes;
+    to->largebytes += from->largebytes;
+    to->wastedbytes += from->wastedbytes + from->heapleft;
+}
+
+/* Called by a thread other than the main one before it exits, so that its
+ * allocations show up in allocmemory_report().  The caller must make sure
+ * no two threads call this at the same time.
+ */
+
+void allocmemory_threadexit()
+{
+    mergeheap(&mergedheap, &heap);
+    memset(&heap, 0, sizeof(heap));
+}
+
+/* Return the number of bytes allocmemory() has handed out to this thread,
+ * for measuring the memory used by one step of the compilation.
+ */
+
+size_t allocmemory_bytes()
+{
+    return heap.totalbytes;
+}
+
+/* Print statistics about allocmemory() usage to fp.
+ */
+
+void allocmemory_report(FILE *fp)
+{
+    static const char *names[MEMmax] =
+    {
+        "other",
+        "Expression",
+        "Statement",
+        "Dsymbol",
+        "Type",
+        "Initializer",
+    };
+
+    Heap h = mergedheap;
+    mergeheap(&h, &heap);
+
+    size_t count = 0;
+    size_t bytes = 0;
+
+    fprintf(fp, "\nD front-end memory usage:\n");
+    fprintf(fp, "%-16s %12s %14s %10s\n", "Kind", "Allocated", "Bytes", "Avg size");
+    for (size_t i = 0; i < MEMmax; i++)
+    {
+        AllocStats *as = &h.allocstats[i];
+        fprintf(fp, "%-16s %12llu %14llu %10llu\n", names[i],
+                (unsigned long long)as->count, (unsigned long long)as->bytes,
+                (unsigned long long)(as->count ? as->bytes / as->count : 0));
+        count += as->count;
+        bytes += as->bytes;
+    }
+    fprintf(fp, "%-16s %12llu %14llu\n", "Total",
+            (unsigned long long)count, (unsigned long long)bytes);
+    fprintf(fp, "%llu chunks (%llu bytes), %llu bytes in large blocks, %llu bytes unused\n",
+            (unsigned long long)h.nchunks, (unsigned long long)h.chunkbytes,
+            (unsigned long long)h.largebytes, (unsigned long long)h.wastedbytes);
+}
@@ -11,6 +11,14 @@
 #define ROOT_MEM_H
 
 #include <stddef.h>     // for size_t
+#include <stdio.h>      // for FILE
+
+// Storage class for per-thread state, used by the parallel parser.
+#if _MSC_VER
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
 
 struct Mem
 {
@@ -27,4 +35,35 @@ struct Mem
 
 extern Mem mem;
 
+/* Categories of memory handed out by allocmemory(), used only for
+ * the statistics reported by allocmemory_report().
+ */
+enum MEMKIND
+{
+    MEMother,
+    MEMexpression,
+    MEMstatement,
+    MEMdsymbol,
+    MEMtype,
+    MEMinitializer,
+    MEMmax
+};
+
+/* Bump-pointer region allocator for memory that is never freed,
+ * such as AST nodes.
+ */
+void *allocmemory(size_t m_size, MEMKIND kind = MEMother);
+void allocmemory_report(FILE *fp);
+size_t allocmemory_bytes();
+void allocmemory_threadexit();
+
+/* Class-scope allocation operators for the AST node classes, so that
+ * allocations are attributed to the right MEMKIND.  Placement new is
+ * redeclared because the class-scope operator hides the global one.
+ */
+#define DECLARE_ALLOCATOR(kind)                                             \
+    static void *operator new(size_t m_size) { return allocmemory(m_size, kind); } \
+    static void *operator new(size_t, void *p) { return p; }               \
+    static void operator delete(void *) { }
+
 #endif /* ROOT_MEM_H */
@@ -33,6 +33,7 @@
 #include "import.h"
 
 bool walkPostorder(Statement *s, StoppableVisitor *v);
+bool walkPostorder(Expression *e, StoppableVisitor *v);
 StorageClass mergeFuncAttrs(StorageClass s1, FuncDeclaration *f);
 
 Identifier *fixupLabelName(Scope *sc, Identifier *ident)
@@ -1583,6 +1584,160 @@ Statement *ForeachStatement::syntaxCopy()
         endloc);
 }
 
+/*****************************************
+ * v is the index of a foreach loop s that goes over 0 .. e.length.
+ * If e is a local dynamic array, and neither e nor v can be changed
+ * in the loop, mark v as always being in bounds for e.
+ */
+
+static void setBoundsArray(Scope *sc, Statement *s, VarDeclaration *v, Expression *e)
+{
+    /* Look for any use of v or a.
+     */
+    class UsesVar : public StoppableVisitor
+    {
+    public:
+        VarDeclaration *v;
+        VarDeclaration *a;
+
+        void visit(Expression *e) {}
+
+        void visit(SymbolExp *e)
+        {
+            VarDeclaration *var = e->var->isVarDeclaration();
+            stop = var == v || var == a;
+        }
+    };
+
+    /* Look for anything that could change v or the length of a.
+     */
+    class ChangesVar : public StoppableVisitor
+    {
+    public:
+        VarDeclaration *v;
+        VarDeclaration *a;
+
+        /* Returns true if changing the lvalue e could change v or a.
+         */
+        bool refersTo(Expression *e)
+        {
+            switch (e->op)
+            {
+                case TOKvar:
+                case TOKsymoff:
+                {
+                    VarDeclaration *var = ((SymbolExp *)e)->var->isVarDeclaration();
+                    return var == v || var == a;
+                }
+                case TOKcast:
+                    return refersTo(((CastExp *)e)->e1);
+                case TOKarraylength:
+                    return refersTo(((ArrayLengthExp *)e)->e1);
+                case TOKcomma:
+                    return refersTo(((CommaExp *)e)->e2);
+                case TOKquestion:
+                    return refersTo(((CondExp *)e)->e1) || refersTo(((CondExp *)e)->e2);
+
+                // Elements and fields, which are not v or a
+                case TOKindex:
+                case TOKslice:
+                case TOKstar:
+                case TOKdotvar:
+                    return false;
+
+                default:
+                {
+                    // Don't know what e is, so assume it is v or a if it uses them
+                    UsesVar uv;
+                    uv.v = v;
+                    uv.a = a;
+                    return walkPostorder(e, &uv);
+                }
+            }
+        }
+
+        void visit(Expression *e) {}
+        void visit(ConstructExp *e) {}
+        void visit(BlitExp *e) {}
+        void visit(AssignExp *e) { stop = refersTo(e->e1); }
+        void visit(BinAssignExp *e) { stop = refersTo(e->e1); }
+        void visit(PreExp *e) { stop = refersTo(e->e1); }
+        void visit(PostExp *e) { stop = refersTo(e->e1); }
+        void visit(AddrExp *e) { stop = refersTo(e->e1); }
+        void visit(SymOffExp *e) { stop = refersTo(e); }
+
+        void visit(CallExp *e)
+        {
+            Type *t = e->e1->type->toBasetype();
+            if (t->ty == Tdelegate || t->ty == Tpointer)
+                t = t->nextOf()->toBasetype();
+            if (t->ty != Tfunction || !e->arguments)
+                return;
+            TypeFunction *tf = (TypeFunction *)t;
+            for (size_t i = 0; i < e->arguments->dim; i++)
+            {
+                Parameter *p = Parameter::getNth(tf->parameters, i);
+                if (p && (p->storageClass & (STCref | STCout)) && refersTo((*e->arguments)[i]))
+                {
+                    stop = true;
+                    return;
+                }
+            }
+        }
+
+        void visit(DeclarationExp *e)
+        {
+            VarDeclaration *vd = e->declaration->isVarDeclaration();
+            ExpInitializer *ie = vd && vd->init ? vd->init->isExpInitializer() : NULL;
+            if (ie)
+                stop = walkPostorder(ie->exp, this);
+        }
+    };
+
+    class ChangesVarInStatement : public StoppableVisitor
+    {
+    public:
+        ChangesVar *cv;
+
+        void check(Expression *e)
+        {
+            if (e && !stop)
+                stop = walkPostorder(e, cv);
+        }
+
+        void visit(Statement *s) {}
+        void visit(ExpStatement *s) { check(s->exp); }
+        void visit(IfStatement *s) { check(s->condition); }
+        void visit(DoStatement *s) { check(s->condition); }
+        void visit(ForStatement *s) { check(s->condition); check(s->increment); }
+        void visit(SwitchStatement *s) { check(s->condition); }
+        void visit(ReturnStatement *s) { check(s->exp); }
+        void visit(SynchronizedStatement *s) { check(s->exp); }
+        void visit(WithStatement *s) { check(s->exp); }
+        void visit(ThrowStatement *s) { check(s->exp); }
+    };
+
+    if (!v || v->type->toBasetype()->ty != Type::tsize_t->ty || e->op != TOKvar)
+        return;
+
+    VarDeclaration *a = ((VarExp *)e)->var->isVarDeclaration();
+    if (!a || a->isDataseg() || (a->storage_class & (STCref | STCout | STClazy)) ||
+        a->toParent2() != sc->func || a->type->toBasetype()->ty != Tarray)
+        return;
+
+    // Could be changed by a nested function
+    if (v->nestedrefs.dim || a->nestedrefs.dim)
+        return;
+
+    ChangesVar cv;
+    cv.v = v;
+    cv.a = a;
+    ChangesVarInStatement cvs;
+    cvs.cv = &cv;
+    if (!walkPostorder(s, &cvs))
+        v->boundsArray = a;
+}
+
 Statement *ForeachStatement::semantic(Scope *sc)
 {
     //printf("ForeachStatement::semantic() %p\n", this);
@@ -2014,6 +2169,7 @@ Statement *ForeachStatement::semantic(Scope *sc)
             // T value = tmp[key];
             value->init = new ExpInitializer(loc, new IndexExp(loc, new VarExp(loc, tmp), new VarExp(loc, key)));
             Statement *ds = new ExpStatement(loc, value);
+            VarDeclaration *vindex = NULL;
 
             if (dim == 2)
             {
@@ -2030,6 +2186,8 @@ Statement *ForeachStatement::semantic(Scope *sc)
                     VarDeclaration *v = new VarDeclaration(loc, p->type, p->ident, ei);
                     v->storage_class |= STCforeach | (p->storageClass & STCref);
                     body = new CompoundStatement(loc, new ExpStatement(loc, v), body);
+                    if (!(p->storageClass & STCref))
+                        vindex = v;
                     if (key->range && !p->type->isMutable())
                     {
                         /* Limit the range of the key to the specified range
@@ -2044,6 +2202,7 @@ Statement *ForeachStatement::semantic(Scope *sc)
             if (LabelStatement *ls = checkLabeledLoop(sc, this))
                 ls->gotoTarget = s;
             s = s->semantic(sc);
+            setBoundsArray(sc, s, vindex, aggr);
             break;
         }
 
@@ -2747,6 +2906,7 @@ Statement *ForeachRangeStatement::semantic(Scope *sc)
         //increment = new AddAssignExp(loc, new VarExp(loc, key), new IntegerExp(1));
         increment = new PreExp(TOKpreplusplus, loc, new VarExp(loc, key));
 
+    VarDeclaration *vindex = NULL;
     if ((prm->storageClass & STCref) && prm->type->equals(key->type))
     {
         key->range = NULL;
@@ -2759,6 +2919,8 @@ Statement *ForeachRangeStatement::semantic(Scope *sc)
         VarDeclaration *v = new VarDeclaration(loc, prm->type, prm->ident, ie);
         v->storage_class |= STCtemp | STCforeach | (prm->storageClass & STCref);
         body = new CompoundStatement(loc, new ExpStatement(loc, v), body);
+        if (!(prm->storageClass & STCref))
+            vindex = v;
         if (key->range && !prm->type->isMutable())
         {
             /* Limit the range of the key to the specified range
@@ -2779,7 +2941,13 @@ Statement *ForeachRangeStatement::semantic(Scope *sc)
     ForStatement *s = new ForStatement(loc, forinit, cond, increment, body, endloc);
     if (LabelStatement *ls = checkLabeledLoop(sc, this))
         ls->gotoTarget = s;
-    return s->semantic(sc);
+    Statement *result = s->semantic(sc);
+
+    /* foreach (i; lwr .. a.length) a[i] is always in bounds.
+     */
+    if (upr->op == TOKarraylength)
+        setBoundsArray(sc, result, vindex, ((ArrayLengthExp *)upr)->e1);
+    return result;
 }
 
 bool ForeachRangeStatement::hasBreak()
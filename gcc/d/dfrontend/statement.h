@@ -79,6 +79,8 @@ enum BE
 class Statement : public RootObject
 {
 public:
+    DECLARE_ALLOCATOR(MEMstatement)
+
     Loc loc;
 
     Statement(Loc loc);
@@ -13,6 +13,8 @@
 
 #include <stdio.h>
 #include <assert.h>
+#include <string.h>
+#include <time.h>
 
 #include "root.h"
 #include "aav.h"
@@ -364,40 +366,82 @@ int arrayObjectMatch(Objects *oa1, Objects *oa2)
 }
 
 
+/************************************
+ * Mix value v into hash h.
+ * Template arguments hash pointers and small integers, which are
+ * poorly distributed in the low bits, so every value goes through
+ * the MurmurHash3 64 bit finalizer before it is combined.
+ */
+static hash_t mixHash(hash_t h, d_uns64 v)
+{
+    v ^= v >> 33;
+    v *= 0xFF51AFD7ED558CCDULL;
+    v ^= v >> 33;
+    v *= 0xC4CEB9FE1A85EC53ULL;
+    v ^= v >> 33;
+    d_uns64 x = (d_uns64)h;
+    x ^= v + 0x9E3779B97F4A7C15ULL + (x << 6) + (x >> 2);
+    return (hash_t)x;
+}
+
+/************************************
+ * Return hash of Expression e, consistent with e->equals().
+ */
+static hash_t expressionHash(Expression *e)
+{
+    hash_t hash = mixHash(0, e->op);
+    switch (e->op)
+    {
+        case TOKint64:
+            return mixHash(hash, ((IntegerExp *)e)->getInteger());
+
+        case TOKstring:
+        {
+            StringExp *se = (StringExp *)e;
+            hash = mixHash(hash, se->len);
+            const unsigned char *p = (const unsigned char *)se->string;
+            size_t n = se->len * se->sz;
+            for (size_t i = 0; i < n; i++)
+                hash = hash * 31 + p[i];
+            return mixHash(hash, 0);
+        }
+
+        default:
+            return hash;
+    }
+}
+
 /************************************
  * Return hash of Objects.
  */
 hash_t arrayObjectHash(Objects *oa1)
 {
-    hash_t hash = 0;
+    hash_t hash = mixHash(0, oa1->dim);
     for (size_t j = 0; j < oa1->dim; j++)
     {
         /* Must follow the logic of match()
          */
         RootObject *o1 = (*oa1)[j];
         if (Type *t1 = isType(o1))
-            hash += (size_t)t1->deco;
+            hash = mixHash(hash, (size_t)t1->deco);
         else
         {
             Dsymbol *s1 = isDsymbol(o1);
             Expression *e1 = s1 ? getValue(s1) : getValue(isExpression(o1));
             if (e1)
-            {
-                if (e1->op == TOKint64)
-                {
-                    IntegerExp *ne = (IntegerExp *)e1;
-                    hash += (size_t)ne->getInteger();
-                }
-            }
+                hash = mixHash(hash, expressionHash(e1));
             else if (s1)
             {
                 FuncAliasDeclaration *fa1 = s1->isFuncAliasDeclaration();
                 if (fa1)
                     s1 = fa1->toAliasFunc();
-                hash += (size_t)(void *)s1->getIdent() + (size_t)(void *)s1->parent;
+                hash = mixHash(hash, (size_t)(void *)s1->getIdent());
+                // match() does not compare the parents of functions
+                if (!s1->isFuncDeclaration())
+                    hash = mixHash(hash, (size_t)(void *)s1->parent);
             }
             else if (Tuple *u1 = isTuple(o1))
-                hash += arrayObjectHash(&u1->objects);
+                hash = mixHash(hash, arrayObjectHash(&u1->objects));
         }
     }
     return hash;
@@ -415,6 +459,271 @@ RootObject *objectSyntaxCopy(RootObject *o)
 }
 
 
+/* ======================== Template trace ================================== */
+
+/* With -ftime-trace=file, the time and AST memory spent on instantiating
+ * templates is recorded, and written out as Chrome trace events.
+ */
+
+// Shorter events are only counted in the totals, to keep the file small
+#define TRACE_GRANULARITY 100   // microseconds
+
+enum TRACEKIND
+{
+    TRACEinstantiate,
+    TRACEsemantic2,
+    TRACEsemantic3,
+    TRACEdeduce,
+    TRACEmax
+};
+
+static const char *traceNames[TRACEmax] =
+{
+    "Instantiate",
+    "Semantic2",
+    "Semantic3",
+    "Deduce",
+};
+
+struct TraceEvent
+{
+    TRACEKIND kind;
+    const char *detail;         // instance or template being processed
+    Module *module;             // instantiating module, NULL if speculative
+    clock_t start;
+    clock_t time;
+    size_t bytes;
+};
+
+struct TraceTotal
+{
+    const char *name;
+    size_t count;               // instantiations, or deductions for TRACEdeduce
+    clock_t inclusive;          // including nested instantiations
+    clock_t exclusive;
+    size_t inclusiveBytes;
+    size_t exclusiveBytes;
+};
+
+static clock_t traceStart;
+static Array<TraceEvent> traceEvents;
+static AA *templateTotalTable;
+static AA *moduleTotalTable;
+static Array<TraceTotal *> templateTotals;
+static Array<TraceTotal *> moduleTotals;
+
+static TraceTotal *getTraceTotal(AA **table, Array<TraceTotal *> *totals, void *key)
+{
+    TraceTotal **ptt = (TraceTotal **)dmd_aaGet(table, key);
+    if (!*ptt)
+    {
+        TraceTotal *tt = new TraceTotal();
+        memset(tt, 0, sizeof(TraceTotal));
+        totals->push(tt);
+        *ptt = tt;
+    }
+    return *ptt;
+}
+
+/* Measures one traced step from its construction to its destruction.
+ * Nested steps are subtracted from the exclusive figures of the
+ * enclosing one.
+ */
+struct TemplateTrace
+{
+    static TemplateTrace *current;
+
+    TemplateTrace *outer;
+    TRACEKIND kind;
+    TemplateInstance *ti;
+    TemplateDeclaration *td;
+    Module *module;
+    clock_t start;
+    size_t bytes;
+    clock_t childTime;
+    size_t childBytes;
+
+    TemplateTrace(TRACEKIND kind, TemplateInstance *ti, TemplateDeclaration *td = NULL, Module *module = NULL)
+    {
+        this->kind = TRACEmax;
+        if (!global.params.timeTraceFile)
+            return;
+        this->kind = kind;
+        this->ti = ti;
+        this->td = td;
+        this->module = module;
+        this->childTime = 0;
+        this->childBytes = 0;
+        this->outer = current;
+        current = this;
+        this->bytes = allocmemory_bytes();
+        this->start = clock();
+        if (!traceStart)
+            traceStart = start;
+    }
+
+    ~TemplateTrace()
+    {
+        if (kind == TRACEmax)
+            return;
+        clock_t time = clock() - start;
+        size_t nbytes = allocmemory_bytes() - bytes;
+        current = outer;
+        if (outer)
+        {
+            outer->childTime += time;
+            outer->childBytes += nbytes;
+        }
+
+        if (!td && ti && ti->tempdecl)
+            td = ti->tempdecl->isTemplateDeclaration();
+        if (!td)
+            return;
+        if (ti && kind != TRACEdeduce)
+            module = ti->minst;
+
+        TraceTotal *tt = getTraceTotal(&templateTotalTable, &templateTotals, td);
+        if (!tt->name)
+            tt->name = td->toPrettyChars();
+        addTotals(tt, time, nbytes);
+
+        TraceTotal *mt = getTraceTotal(&moduleTotalTable, &moduleTotals, module);
+        if (!mt->name)
+            mt->name = module ? module->toPrettyChars() : "(speculative)";
+        addTotals(mt, time, nbytes);
+
+        if (time * 1000000.0 / CLOCKS_PER_SEC >= TRACE_GRANULARITY)
+        {
+            TraceEvent ev;
+            ev.kind = kind;
+            ev.detail = (ti && kind != TRACEdeduce) ? ti->toPrettyChars() : tt->name;
+            ev.module = module;
+            ev.start = start - traceStart;
+            ev.time = time;
+            ev.bytes = nbytes;
+            traceEvents.push(ev);
+        }
+    }
+
+    void addTotals(TraceTotal *tt, clock_t time, size_t nbytes)
+    {
+        if (kind == TRACEinstantiate || kind == TRACEdeduce)
+            tt->count++;
+        tt->exclusive += time - childTime;
+        tt->exclusiveBytes += nbytes - childBytes;
+
+        // Nested steps for the same key are already included in the outer one
+        for (TemplateTrace *tr = outer; tr; tr = tr->outer)
+        {
+            if (tt == tr->templateTotal() || tt == tr->moduleTotal())
+                return;
+        }
+        tt->inclusive += time;
+        tt->inclusiveBytes += nbytes;
+    }
+
+    TraceTotal *templateTotal()
+    {
+        TemplateDeclaration *d = td;
+        if (!d && ti && ti->tempdecl)
+            d = ti->tempdecl->isTemplateDeclaration();
+        return d ? (TraceTotal *)dmd_aaGetRvalue(templateTotalTable, d) : NULL;
+    }
+
+    TraceTotal *moduleTotal()
+    {
+        Module *m = (ti && kind != TRACEdeduce) ? ti->minst : module;
+        return (TraceTotal *)dmd_aaGetRvalue(moduleTotalTable, m);
+    }
+};
+
+TemplateTrace *TemplateTrace::current;
+
+static void writeJsonString(OutBuffer *buf, const char *s)
+{
+    buf->writeByte('"');
+    for (; *s; s++)
+    {
+        unsigned char c = *s;
+        if (c == '"' || c == '\\')
+        {
+            buf->writeByte('\\');
+            buf->writeByte(c);
+        }
+        else if (c < 0x20)
+            buf->printf("\\u%04x", c);
+        else
+            buf->writeByte(c);
+    }
+    buf->writeByte('"');
+}
+
+static double toMicrosecs(clock_t t)
+{
+    return t * 1000000.0 / CLOCKS_PER_SEC;
+}
+
+static int traceTotalCmp(const void *p1, const void *p2)
+{
+    TraceTotal *tt1 = *(TraceTotal **)p1;
+    TraceTotal *tt2 = *(TraceTotal **)p2;
+    if (tt1->inclusive != tt2->inclusive)
+        return tt1->inclusive < tt2->inclusive ? 1 : -1;
+    return tt1->exclusive < tt2->exclusive ? 1 : (tt1->exclusive > tt2->exclusive ? -1 : 0);
+}
+
+/* Write the totals as consecutive events on thread tid, so that viewers
+ * show them as a bar chart sorted by inclusive time.
+ */
+static void writeTraceTotals(OutBuffer *buf, Array<TraceTotal *> *totals, int tid, const char *title)
+{
+    buf->printf(",\n{\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"name\":\"thread_name\",\"args\":{\"name\":", tid);
+    writeJsonString(buf, title);
+    buf->writestring("}}");
+
+    qsort(totals->tdata(), totals->dim, sizeof(TraceTotal *), &traceTotalCmp);
+    double ts = 0;
+    for (size_t i = 0; i < totals->dim; i++)
+    {
+        TraceTotal *tt = (*totals)[i];
+        double dur = toMicrosecs(tt->inclusive);
+        buf->printf(",\n{\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.0f,\"dur\":%.0f,\"cat\":\"total\",\"name\":", tid, ts, dur);
+        writeJsonString(buf, tt->name);
+        buf->printf(",\"args\":{\"count\":%llu,\"inclusive_us\":%.0f,\"exclusive_us\":%.0f,\"inclusive_bytes\":%llu,\"exclusive_bytes\":%llu}}",
+            (ulonglong)tt->count, dur, toMicrosecs(tt->exclusive),
+            (ulonglong)tt->inclusiveBytes, (ulonglong)tt->exclusiveBytes);
+        ts += dur;
+    }
+}
+
+/****************************************************
+ * Write the trace gathered for -ftime-trace to buf in the Chrome
+ * trace event format.  Thread 0 has the individual events and a
+ * counter for the constraint cache, threads 1 and 2 the totals for each
+ * template declaration and each instantiating module.
+ */
+
+void printTemplateTrace(OutBuffer *buf)
+{
+    buf->writestring("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    buf->writestring("{\"ph\":\"M\",\"pid\":1,\"tid\":0,\"name\":\"thread_name\",\"args\":{\"name\":\"Templates\"}}");
+    for (size_t i = 0; i < traceEvents.dim; i++)
+    {
+        TraceEvent *ev = &traceEvents[i];
+        buf->printf(",\n{\"ph\":\"X\",\"pid\":1,\"tid\":0,\"ts\":%.0f,\"dur\":%.0f,\"cat\":\"template\",\"name\":\"%s\",\"args\":{\"detail\":",
+            toMicrosecs(ev->start), toMicrosecs(ev->time), traceNames[ev->kind]);
+        writeJsonString(buf, ev->detail);
+        buf->writestring(",\"module\":");
+        writeJsonString(buf, ev->module ? ev->module->toPrettyChars() : "(speculative)");
+        buf->printf(",\"bytes\":%llu}}", (ulonglong)ev->bytes);
+    }
+    buf->printf(",\n{\"ph\":\"C\",\"pid\":1,\"tid\":0,\"ts\":0,\"name\":\"Constraints\",\"args\":{\"evaluated\":%llu,\"cached\":%llu}}",
+        (ulonglong)TemplateDeclaration::numConstraintEvals, (ulonglong)TemplateDeclaration::numConstraintHits);
+    writeTraceTotals(buf, &templateTotals, 1, "Total per template");
+    writeTraceTotals(buf, &moduleTotals, 2, "Total per instantiating module");
+    buf->writestring("\n]}\n");
+}
+
 /* ======================== TemplateDeclaration ============================= */
 
 TemplateDeclaration::TemplateDeclaration(Loc loc, Identifier *id,
@@ -452,7 +761,12 @@ TemplateDeclaration::TemplateDeclaration(Loc loc, Identifier *id,
     this->isstatic = true;
     this->previous = NULL;
     this->protection = Prot(PROTundefined);
+    this->instances = NULL;
+    this->numslots = 0;
     this->numinstances = 0;
+    this->numdeleted = 0;
+    this->stats = NULL;
+    this->constraintCache = NULL;
 
     // Compute in advance for Ddoc's use
     // Bugzilla 11153: ident could be NULL if parsing fails.
@@ -648,6 +962,181 @@ bool TemplateDeclaration::overloadInsert(Dsymbol *s)
     return true;
 }
 
+/****************************
+ * The results of constraints already evaluated for a TemplateDeclaration,
+ * keyed by the deduced arguments and, for function templates, the types
+ * and storage classes of the function parameters.
+ */
+
+struct ConstraintResult
+{
+    hash_t hash;
+    Objects *dedargs;
+    Array<size_t> *fparams;     // deco and storage class of each parameter, or NULL
+    bool result;
+};
+
+struct ConstraintCache
+{
+    ConstraintResult **slots;
+    size_t numslots;            // a power of 2
+    size_t count;
+};
+
+size_t TemplateDeclaration::numConstraintHits;
+size_t TemplateDeclaration::numConstraintEvals;
+
+// Incremented whenever a constraint is failed as a recursive instantiation
+static size_t numRecursiveConstraints;
+
+/* Return the key for the parameters of fd, or NULL if fd is NULL.
+ * Set *cacheable to false if the parameter types are not yet known.
+ */
+static Array<size_t> *functionParamsKey(FuncDeclaration *fd, bool *cacheable)
+{
+    if (!fd)
+        return NULL;
+    TypeFunction *tf = (TypeFunction *)fd->type;
+    Array<size_t> *key = new Array<size_t>();
+    size_t nfparams = Parameter::dim(tf->parameters);
+    key->reserve(nfparams * 2 + 2);
+    for (size_t i = 0; i < nfparams; i++)
+    {
+        Parameter *fparam = Parameter::getNth(tf->parameters, i);
+        if (!fparam->type || !fparam->type->deco)
+            *cacheable = false;
+        key->push((size_t)(fparam->type ? fparam->type->deco : NULL));
+        key->push((size_t)fparam->storageClass);
+    }
+    key->push((size_t)tf->varargs);
+    key->push((size_t)tf->mod);
+    return key;
+}
+
+/* Return true if o is, or has a type built from, an aggregate whose
+ * semantic analysis has not finished, so that what a constraint finds
+ * out about it may still change.
+ */
+static bool hasIncompleteAggregate(RootObject *o)
+{
+    if (!o)
+        return false;
+    if (Tuple *v = isTuple(o))
+    {
+        for (size_t i = 0; i < v->objects.dim; i++)
+        {
+            if (hasIncompleteAggregate(v->objects[i]))
+                return true;
+        }
+        return false;
+    }
+    if (Expression *e = isExpression(o))
+        return hasIncompleteAggregate(e->type);
+    if (Dsymbol *s = isDsymbol(o))
+    {
+        if (AggregateDeclaration *ad = s->isAggregateDeclaration())
+            return ad->sizeok != SIZEOKdone || ad->semanticRun < PASSsemanticdone;
+        if (Declaration *d = s->isDeclaration())
+            return hasIncompleteAggregate(d->type);
+        return false;
+    }
+    for (Type *t = isType(o); t; t = t->nextOf())
+    {
+        t = t->toBasetype();
+        AggregateDeclaration *ad = NULL;
+        if (t->ty == Tstruct)
+            ad = ((TypeStruct *)t)->sym;
+        else if (t->ty == Tclass)
+            ad = ((TypeClass *)t)->sym;
+        else if (t->ty == Taarray && hasIncompleteAggregate(((TypeAArray *)t)->index))
+            return true;
+        if (ad && (ad->sizeok != SIZEOKdone || ad->semanticRun < PASSsemanticdone))
+            return true;
+    }
+    return false;
+}
+
+static hash_t constraintHash(Objects *dedargs, Array<size_t> *fparams)
+{
+    hash_t hash = arrayObjectHash(dedargs);
+    if (fparams)
+    {
+        for (size_t i = 0; i < fparams->dim; i++)
+            hash = mixHash(hash, (*fparams)[i]);
+    }
+    return hash;
+}
+
+static bool constraintMatch(ConstraintResult *cr, hash_t hash, Objects *dedargs, Array<size_t> *fparams)
+{
+    if (cr->hash != hash || !cr->fparams != !fparams)
+        return false;
+    if (fparams)
+    {
+        if (cr->fparams->dim != fparams->dim ||
+            memcmp(cr->fparams->tdata(), fparams->tdata(), fparams->dim * sizeof(size_t)) != 0)
+            return false;
+    }
+    return arrayObjectMatch(cr->dedargs, dedargs) != 0;
+}
+
+static ConstraintResult *findConstraintResult(ConstraintCache *cc, hash_t hash, Objects *dedargs, Array<size_t> *fparams)
+{
+    if (!cc)
+        return NULL;
+    size_t mask = cc->numslots - 1;
+    for (size_t i = hash & mask; cc->slots[i]; i = (i + 1) & mask)
+    {
+        if (constraintMatch(cc->slots[i], hash, dedargs, fparams))
+            return cc->slots[i];
+    }
+    return NULL;
+}
+
+static void addConstraintResult(ConstraintCache **pcc, hash_t hash, Objects *dedargs, Array<size_t> *fparams, bool result)
+{
+    ConstraintCache *cc = *pcc;
+    if (!cc)
+    {
+        cc = new ConstraintCache();
+        cc->numslots = 8;
+        cc->slots = (ConstraintResult **)mem.xcalloc(cc->numslots, sizeof(ConstraintResult *));
+        cc->count = 0;
+        *pcc = cc;
+    }
+    else if ((cc->count + 1) * 2 > cc->numslots)
+    {
+        size_t newdim = cc->numslots * 2;
+        ConstraintResult **newp = (ConstraintResult **)mem.xcalloc(newdim, sizeof(ConstraintResult *));
+        for (size_t i = 0; i < cc->numslots; i++)
+        {
+            ConstraintResult *cr = cc->slots[i];
+            if (!cr)
+                continue;
+            size_t j = cr->hash & (newdim - 1);
+            while (newp[j])
+                j = (j + 1) & (newdim - 1);
+            newp[j] = cr;
+        }
+        mem.xfree(cc->slots);
+        cc->slots = newp;
+        cc->numslots = newdim;
+    }
+
+    ConstraintResult *cr = new ConstraintResult();
+    cr->hash = hash;
+    cr->dedargs = dedargs->copy();
+    cr->fparams = fparams;
+    cr->result = result;
+
+    size_t mask = cc->numslots - 1;
+    size_t i = hash & mask;
+    while (cc->slots[i])
+        i = (i + 1) & mask;
+    cc->slots[i] = cr;
+    cc->count++;
+}
+
 /****************************
  * Check to see if constraint is satisfied.
  */
@@ -679,7 +1168,10 @@ bool TemplateDeclaration::evaluateConstraint(
             for (Scope *scx = sc; scx; scx = scx->enclosing)
             {
                 if (scx == p->sc)
+                {
+                    numRecursiveConstraints++;
                     return false;
+                }
             }
         }
         /* BUG: should also check for ref param differences
@@ -743,39 +1235,89 @@ bool TemplateDeclaration::evaluateConstraint(
         fd->vthis = fd->declareThis(scx, fd->isThis());
     }
 
-    Expression *e = constraint->syntaxCopy();
+    /* The same constraint is often tried with the same arguments many
+     * times during overload resolution, so look for an earlier result.
+     */
+    bool cacheable = true;
+    Array<size_t> *fparams = functionParamsKey(fd, &cacheable);
+    hash_t hash = constraintHash(dedargs, fparams);
+    ConstraintResult *cr = cacheable ? findConstraintResult(constraintCache, hash, dedargs, fparams) : NULL;
+    unsigned totalErrors = global.totalErrors;
+    size_t recursions = numRecursiveConstraints;
+
+    Expression *e = NULL;
+    if (!cr)
+    {
+        e = constraint->syntaxCopy();
 
-    scx = scx->startCTFE();
-    scx->flags |= SCOPEcondition | SCOPEconstraint;
-    assert(ti->inst == NULL);
-    ti->inst = ti;  // temporary instantiation to enable genIdent()
+        scx = scx->startCTFE();
+        scx->flags |= SCOPEcondition | SCOPEconstraint;
+        assert(ti->inst == NULL);
+        ti->inst = ti;  // temporary instantiation to enable genIdent()
 
-    //printf("\tscx->parent = %s %s\n", scx->parent->kind(), scx->parent->toPrettyChars());
-    e = e->semantic(scx);
-    e = resolveProperties(scx, e);
+        //printf("\tscx->parent = %s %s\n", scx->parent->kind(), scx->parent->toPrettyChars());
+        e = e->semantic(scx);
+        e = resolveProperties(scx, e);
 
-    ti->inst = NULL;
+        ti->inst = NULL;
+        scx = scx->endCTFE();
+    }
     ti->symtab = NULL;
-    scx = scx->endCTFE();
 
     scx = scx->pop();
     previous = pr.prev;             // unlink from threaded list
 
-    if (nerrors != global.errors)   // if any errors from evaluating the constraint, no match
-        return false;
-    if (e->op == TOKerror)
-        return false;
+    if (cr)
+    {
+        numConstraintHits++;
+        return cr->result;
+    }
+    numConstraintEvals++;
 
-    e = e->ctfeInterpret();
-    if (e->isBool(true))
-        ;
-    else if (e->isBool(false))
-        return false;
+    bool result = true;
+    if (nerrors != global.errors)   // if any errors from evaluating the constraint, no match
+        result = false;
+    else if (e->op == TOKerror)
+        result = false;
     else
     {
-        e->error("constraint %s is not constant or does not evaluate to a bool", e->toChars());
+        e = e->ctfeInterpret();
+        if (e->isBool(true))
+            ;
+        else if (e->isBool(false))
+            result = false;
+        else
+        {
+            e->error("constraint %s is not constant or does not evaluate to a bool", e->toChars());
+        }
     }
-    return true;
+
+    /* Gagged errors, recursive instantiations and aggregates that are
+     * still being analyzed can all depend on what is being analyzed at
+     * the moment, such as forward references, so only results that did
+     * not run into any of them are kept.
+     */
+    for (size_t i = 0; cacheable && i < dedargs->dim; i++)
+    {
+        if (hasIncompleteAggregate((*dedargs)[i]))
+            cacheable = false;
+    }
+    if (fd && cacheable)
+    {
+        TypeFunction *tf = (TypeFunction *)fd->type;
+        for (size_t i = 0; cacheable && i < Parameter::dim(tf->parameters); i++)
+        {
+            if (hasIncompleteAggregate(Parameter::getNth(tf->parameters, i)->type))
+                cacheable = false;
+        }
+    }
+    if (cacheable &&
+        global.totalErrors == totalErrors &&
+        numRecursiveConstraints == recursions)
+    {
+        addConstraintResult(&constraintCache, hash, dedargs, fparams, result);
+    }
+    return result;
 }
 
 /***************************************
@@ -1123,6 +1665,8 @@ MATCH TemplateDeclaration::deduceFunctionTemplateMatch(
     unsigned wildmatch = 0;
     size_t inferStart = 0;
 
+    TemplateTrace trace(TRACEdeduce, ti, this, sc->minst);
+
     Loc instLoc = ti->loc;
     Objects *tiargs = ti->tiargs;
     Objects *dedargs = new Objects();
@@ -2637,6 +3181,109 @@ Prot TemplateDeclaration::prot()
     return protection;
 }
 
+/****************************************************
+ * Statistics about the instance table of a TemplateDeclaration,
+ * gathered for -ftemplate-stats.
+ */
+
+struct TemplateStats
+{
+    TemplateDeclaration *td;
+    size_t numLookups;          // calls of findExistingInstance()
+    size_t numHits;             // lookups that found an existing instance
+    size_t numProbes;           // slots examined by all lookups
+    size_t maxProbes;           // most slots examined by one lookup
+    size_t numCompares;         // calls of TemplateInstance::compare()
+    clock_t time;               // time spent in lookups
+};
+
+static Array<TemplateStats *> templateStats;
+
+static TemplateStats *getTemplateStats(TemplateDeclaration *td)
+{
+    if (!td->stats)
+    {
+        TemplateStats *ts = new TemplateStats();
+        memset(ts, 0, sizeof(TemplateStats));
+        ts->td = td;
+        templateStats.push(ts);
+        td->stats = ts;
+    }
+    return td->stats;
+}
+
+static int templateStatsCmp(const void *p1, const void *p2)
+{
+    TemplateStats *ts1 = *(TemplateStats **)p1;
+    TemplateStats *ts2 = *(TemplateStats **)p2;
+    if (ts1->time != ts2->time)
+        return ts1->time < ts2->time ? 1 : -1;
+    if (ts1->td->numinstances != ts2->td->numinstances)
+        return ts1->td->numinstances < ts2->td->numinstances ? 1 : -1;
+    return ts1->numLookups < ts2->numLookups ? 1 : (ts1->numLookups > ts2->numLookups ? -1 : 0);
+}
+
+/****************************************************
+ * Write the statistics gathered for -ftemplate-stats to buf,
+ * the template declarations with the slowest lookups first.
+ */
+
+void printTemplateStats(OutBuffer *buf)
+{
+    size_t numInstances = 0;
+    size_t numLookups = 0;
+    size_t numProbes = 0;
+    clock_t time = 0;
+    for (size_t i = 0; i < templateStats.dim; i++)
+    {
+        TemplateStats *ts = templateStats[i];
+        numInstances += ts->td->numinstances;
+        numLookups += ts->numLookups;
+        numProbes += ts->numProbes;
+        time += ts->time;
+    }
+
+    buf->printf("Template instances: %llu instances of %llu templates, %llu lookups, %.2f probes per lookup, %.3f ms\n",
+        (ulonglong)numInstances, (ulonglong)templateStats.dim, (ulonglong)numLookups,
+        numLookups ? (double)numProbes / numLookups : 0.0,
+        time * 1000.0 / CLOCKS_PER_SEC);
+
+    /* The size of the bodies that were never copied isn't known, and
+     * they tend to be smaller than those that were analyzed.
+     */
+    size_t numShared = FuncDeclaration::numSharedBodies;
+    size_t numCopied = FuncDeclaration::numCopiedBodies;
+    buf->printf("Function bodies: %llu shared with templates, %llu copied (%llu bytes), %llu never copied\n",
+        (ulonglong)numShared, (ulonglong)numCopied, (ulonglong)FuncDeclaration::copiedBodyBytes,
+        (ulonglong)(numShared - numCopied));
+    buf->printf("Constraints: %llu evaluated, %llu found in cache\n",
+        (ulonglong)TemplateDeclaration::numConstraintEvals, (ulonglong)TemplateDeclaration::numConstraintHits);
+    if (!templateStats.dim)
+        return;
+
+    qsort(templateStats.tdata(), templateStats.dim, sizeof(TemplateStats *), &templateStatsCmp);
+
+    buf->printf("%10s %10s %10s %10s %10s %10s %10s  %s\n",
+        "instances", "slots", "lookups", "hits", "avg probe", "max probe", "ms", "template");
+    for (size_t i = 0; i < templateStats.dim; i++)
+    {
+        TemplateStats *ts = templateStats[i];
+        TemplateDeclaration *td = ts->td;
+        buf->printf("%10llu %10llu %10llu %10llu %10.2f %10llu %10.3f  %s %s\n",
+            (ulonglong)td->numinstances, (ulonglong)td->numslots,
+            (ulonglong)ts->numLookups, (ulonglong)ts->numHits,
+            ts->numLookups ? (double)ts->numProbes / ts->numLookups : 0.0,
+            (ulonglong)ts->maxProbes,
+            ts->time * 1000.0 / CLOCKS_PER_SEC,
+            td->toPrettyChars(), td->loc.toChars());
+    }
+}
+
+/* Marks the slot of a removed instance, so that lookups continue past it.
+ */
+static char deletedInstanceSlot;
+#define deletedInstance ((TemplateInstance *)(void *)&deletedInstanceSlot)
+
 /****************************************************
  * Given a new instance tithis of this TemplateDeclaration,
  * see if there already exists an instance.
@@ -2646,33 +3293,49 @@ Prot TemplateDeclaration::prot()
 TemplateInstance *TemplateDeclaration::findExistingInstance(TemplateInstance *tithis, Expressions *fargs)
 {
     tithis->fargs = fargs;
+    clock_t start = global.params.templateStats ? clock() : 0;
     hash_t hash = tithis->hashCode();
 
-    if (!buckets.dim)
-    {
-        buckets.setDim(7);
-        buckets.zero();
-    }
-    size_t bi = hash % buckets.dim;
-    TemplateInstances *instances = buckets[bi];
-    if (instances)
+    TemplateInstance *result = NULL;
+    size_t probes = 0;
+    size_t compares = 0;
+    if (numslots)
     {
-        for (size_t i = 0; i < instances->dim; i++)
+        size_t mask = numslots - 1;
+        for (size_t i = hash & mask; ; i = (i + 1) & mask)
         {
-            TemplateInstance *ti = (*instances)[i];
+            TemplateInstance *ti = instances[i];
+            probes++;
+            if (!ti)
+                break;
+            if (ti == deletedInstance || ti->hash != hash)
+                continue;
 #if LOG
             printf("\t%s: checking for match with instance %d (%p): '%s'\n", tithis->toChars(), i, ti, ti->toChars());
 #endif
-            if (hash == ti->hash &&
-                tithis->compare(ti) == 0)
+            compares++;
+            if (tithis->compare(ti) == 0)
             {
-                //printf("hash = %p yes %d n = %d\n", hash, instances->dim, numinstances);
-                return ti;
+                result = ti;
+                break;
             }
         }
     }
-    //printf("hash = %p no\n", hash);
-    return NULL;        // didn't find a match
+
+    if (global.params.templateStats)
+    {
+        TemplateStats *ts = getTemplateStats(this);
+        ts->numLookups++;
+        if (result)
+            ts->numHits++;
+        ts->numProbes += probes;
+        if (probes > ts->maxProbes)
+            ts->maxProbes = probes;
+        ts->numCompares += compares;
+        ts->time += clock() - start;
+    }
+    //printf("hash = %p %s n = %d\n", hash, result ? "yes" : "no", numinstances);
+    return result;
 }
 
 /********************************************
@@ -2682,44 +3345,46 @@ TemplateInstance *TemplateDeclaration::findExistingInstance(TemplateInstance *ti
 
 TemplateInstance *TemplateDeclaration::addInstance(TemplateInstance *ti)
 {
-    /* See if we need to rehash
+    /* Keep the table at most half full, counting the slots of removed
+     * instances, so that unsuccessful lookups stay short.
      */
-    if (numinstances > buckets.dim * 4)
+    if ((numinstances + numdeleted + 1) * 2 > numslots)
     {
-        // rehash
-        //printf("rehash\n");
-        size_t newdim = buckets.dim * 2 + 1;
-        TemplateInstances **newp = (TemplateInstances **)::calloc(newdim, sizeof(TemplateInstances *));
-        assert(newp);
-        for (size_t bi = 0; bi < buckets.dim; ++bi)
+        size_t newdim = numslots ? numslots : 8;
+        while ((numinstances + 1) * 2 > newdim)
+            newdim *= 2;
+        if ((numinstances + 1) * 4 > newdim)
+            newdim *= 2;
+
+        TemplateInstance **newp = (TemplateInstance **)mem.xcalloc(newdim, sizeof(TemplateInstance *));
+        size_t mask = newdim - 1;
+        for (size_t i = 0; i < numslots; i++)
         {
-            TemplateInstances *instances = buckets[bi];
-            if (instances)
-            {
-                for (size_t i = 0; i < instances->dim; i++)
-                {
-                    TemplateInstance *ti1 = (*instances)[i];
-                    size_t newbi = ti1->hash % newdim;
-                    TemplateInstances *newinstances = newp[newbi];
-                    if (!newinstances)
-                        newp[newbi] = newinstances = new TemplateInstances();
-                    newinstances->push(ti1);
-                }
-                delete instances;
-            }
+            TemplateInstance *ti1 = instances[i];
+            if (!ti1 || ti1 == deletedInstance)
+                continue;
+            size_t j = ti1->hash & mask;
+            while (newp[j])
+                j = (j + 1) & mask;
+            newp[j] = ti1;
         }
-        buckets.setDim(newdim);
-        memcpy(buckets.tdata(), newp, newdim * sizeof(TemplateInstance *));
-        ::free(newp);
+        mem.xfree(instances);
+        instances = newp;
+        numslots = newdim;
+        numdeleted = 0;
     }
 
     // Insert ti into hash table
-    size_t bi = ti->hash % buckets.dim;
-    TemplateInstances *instances = buckets[bi];
-    if (!instances)
-        buckets[bi] = instances = new TemplateInstances();
-    instances->push(ti);
+    size_t mask = numslots - 1;
+    size_t i = ti->hash & mask;
+    while (instances[i] && instances[i] != deletedInstance)
+        i = (i + 1) & mask;
+    if (instances[i] == deletedInstance)
+        numdeleted--;
+    instances[i] = ti;
     ++numinstances;
+    if (global.params.templateStats)
+        getTemplateStats(this);
     return ti;
 }
 
@@ -2731,18 +3396,17 @@ TemplateInstance *TemplateDeclaration::addInstance(TemplateInstance *ti)
 
 void TemplateDeclaration::removeInstance(TemplateInstance *handle)
 {
-    size_t bi = handle->hash % buckets.dim;
-    TemplateInstances *instances = buckets[bi];
-    for (size_t i = 0; i < instances->dim; i++)
+    size_t mask = numslots - 1;
+    for (size_t i = handle->hash & mask; instances[i]; i = (i + 1) & mask)
     {
-        TemplateInstance *ti = (*instances)[i];
-        if (handle == ti)
+        if (instances[i] == handle)
         {
-            instances->remove(i);
+            instances[i] = deletedInstance;
+            ++numdeleted;
+            --numinstances;
             break;
         }
     }
-    --numinstances;
 }
 
 /* ======================== Type ============================================ */
@@ -5677,6 +6341,7 @@ void TemplateInstance::semantic(Scope *sc, Expressions *fargs)
         errors = true;
         return;
     }
+    TemplateTrace trace(TRACEinstantiate, this);
 
     // Get the enclosing template instance from the scope tinst
     tinst = sc->tinst;
@@ -5858,7 +6523,9 @@ void TemplateInstance::semantic(Scope *sc, Expressions *fargs)
 #endif
 
     // Copy the syntax trees from the TemplateDeclaration
+    FuncDeclaration::deferBodyCopy++;
     members = Dsymbol::arraySyntaxCopy(tempdecl->members);
+    FuncDeclaration::deferBodyCopy--;
 
     // resolve TemplateThisParameter
     for (size_t i = 0; i < tempdecl->parameters->dim; i++)
@@ -7254,6 +7921,7 @@ void TemplateInstance::semantic2(Scope *sc)
 #endif
     if (!errors && members)
     {
+        TemplateTrace trace(TRACEsemantic2, this);
         TemplateDeclaration *tempdecl = this->tempdecl->isTemplateDeclaration();
         assert(tempdecl);
 
@@ -7314,6 +7982,7 @@ void TemplateInstance::semantic3(Scope *sc)
     semanticRun = PASSsemantic3;
     if (!errors && members)
     {
+        TemplateTrace trace(TRACEsemantic3, this);
         TemplateDeclaration *tempdecl = this->tempdecl->isTemplateDeclaration();
         assert(tempdecl);
 
@@ -7556,8 +8225,9 @@ hash_t TemplateInstance::hashCode()
 {
     if (!hash)
     {
-        hash = (size_t)(void *)enclosing;
-        hash += arrayObjectHash(&tdtypes);
+        hash = mixHash(arrayObjectHash(&tdtypes), (size_t)(void *)enclosing);
+        if (!hash)
+            hash = 1;       // 0 means not computed yet
     }
     return hash;
 }
@@ -7952,7 +8622,9 @@ void TemplateMixin::semantic(Scope *sc)
     }
 
     // Copy the syntax trees from the TemplateDeclaration
+    FuncDeclaration::deferBodyCopy++;
     members = Dsymbol::arraySyntaxCopy(tempdecl->members);
+    FuncDeclaration::deferBodyCopy--;
     if (!members)
         return;
 
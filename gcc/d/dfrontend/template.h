@@ -50,6 +50,9 @@ public:
     int dyncast() { return DYNCAST_TUPLE; }
 };
 
+struct TemplateStats;
+struct ConstraintCache;
+
 struct TemplatePrevious
 {
     TemplatePrevious *prev;
@@ -65,9 +68,12 @@ public:
     TemplateParameters *origParameters; // originals for Ddoc
     Expression *constraint;
 
-    // Hash table to look up TemplateInstance's of this TemplateDeclaration
-    Array<TemplateInstances *> buckets;
+    // Open addressed hash table to look up TemplateInstance's of this TemplateDeclaration
+    TemplateInstance **instances;
+    size_t numslots;                    // number of slots in instances[], a power of 2
     size_t numinstances;                // number of instances in the hash table
+    size_t numdeleted;                  // number of slots of removed instances
+    TemplateStats *stats;               // -ftemplate-stats, or NULL
 
     TemplateDeclaration *overnext;      // next overloaded TemplateDeclaration
     TemplateDeclaration *overroot;      // first in overnext list
@@ -81,6 +87,10 @@ public:
     Prot protection;
 
     TemplatePrevious *previous;         // threaded list of previous instantiation attempts on stack
+    ConstraintCache *constraintCache;   // results of evaluateConstraint()
+
+    static size_t numConstraintHits;
+    static size_t numConstraintEvals;
 
     TemplateDeclaration(Loc loc, Identifier *id, TemplateParameters *parameters,
         Expression *constraint, Dsymbols *decldefs, bool ismixin = false, bool literal = false);
@@ -400,4 +410,7 @@ Dsymbol *getDsymbol(RootObject *o);
 
 RootObject *objectSyntaxCopy(RootObject *o);
 
+void printTemplateStats(OutBuffer *buf);
+void printTemplateTrace(OutBuffer *buf);
+
 #endif /* DMD_TEMPLATE_H */
@@ -220,7 +220,7 @@ struct Token
     static const char *tochars[TOKMAX];
     static void initTokens();
 
-    static Token *freelist;
+    static THREAD_LOCAL Token *freelist;
     static Token *alloc();
     void free();
 
@@ -40,6 +40,23 @@
 #include "id.h"
 
 
+// Switch statements on strings with up to this many cases are lowered to
+// a decision tree, larger ones call the runtime to binary search a table.
+
+#define MAX_STRING_SWITCH_TREE 64
+
+// Build a LABEL_DECL for a label made up by the compiler.
+
+static tree
+build_artificial_label()
+{
+  tree label = build_decl(input_location, LABEL_DECL, NULL_TREE, void_type_node);
+  DECL_CONTEXT (label) = current_function_decl;
+  DECL_ARTIFICIAL (label) = 1;
+  DECL_MODE (label) = VOIDmode;
+  return label;
+}
+
 // Implements the visitor interface to build the GCC trees of all Statement
 // AST classes emitted from the D Front-end.
 // All visit methods accept one parameter S, which holds the frontend AST
@@ -390,6 +407,148 @@ public:
   }
 
   //
+  // Emit the part of the decision tree of a switch on a string that tells
+  // apart CASES, all of which have LEN characters.  PTR points to the
+  // characters of the switch condition.  INDEX is set to the index of
+  // the matching case, if any, then control goes to DONE.
+  void build_string_case_tree(CaseStatements *cases, size_t len, tree ptr,
+			      tree index, tree done)
+  {
+    if (cases->dim == 1)
+      {
+	// One compare of the whole string left.
+	CaseStatement *cs = (*cases)[0];
+	StringExp *se = (StringExp *) cs->exp;
+	tree match = build2(MODIFY_EXPR, void_type_node, index,
+			    build_integer_cst(cs->index, TREE_TYPE (index)));
+	if (len == 0)
+	  add_stmt(match);
+	else
+	  {
+	    tree value = build_string(len * se->sz, (const char *) se->string);
+	    TREE_TYPE (value) = d_array_type(se->type->nextOf(), len);
+	    TREE_CONSTANT (value) = 1;
+
+	    tree cmp = d_build_call_nary(builtin_decl_explicit(BUILT_IN_MEMCMP), 3,
+					 ptr, build_address(value),
+					 size_int(len * se->sz));
+	    add_stmt(build_vcondition(build_boolop(EQ_EXPR, cmp, integer_zero_node),
+				      match, void_node));
+	  }
+	this->do_jump(NULL, done);
+	return;
+      }
+
+    // Switch on the character that splits the cases the most ways.
+    size_t pos = 0;
+    size_t npos = 0;
+    for (size_t i = 0; i < len; i++)
+      {
+	size_t n = 0;
+	for (size_t j = 0; j < cases->dim; j++)
+	  {
+	    unsigned c = ((StringExp *) (*cases)[j]->exp)->charAt(i);
+	    size_t k = 0;
+	    while (k < j && ((StringExp *) (*cases)[k]->exp)->charAt(i) != c)
+	      k++;
+	    if (k == j)
+	      n++;
+	  }
+	if (n > npos)
+	  {
+	    pos = i;
+	    npos = n;
+	  }
+      }
+    gcc_assert(npos > 1);
+
+    tree etype = TREE_TYPE (TREE_TYPE (ptr));
+    tree cond = build_deref(build_array_index(ptr, size_int(pos)));
+
+    push_stmt_list();
+    for (size_t j = 0; j < cases->dim; j++)
+      {
+	unsigned c = ((StringExp *) (*cases)[j]->exp)->charAt(pos);
+	size_t k = 0;
+	while (k < j && ((StringExp *) (*cases)[k]->exp)->charAt(pos) != c)
+	  k++;
+	if (k < j)
+	  continue;		// already handled with an earlier case
+
+	CaseStatements group;
+	for (k = j; k < cases->dim; k++)
+	  {
+	    if (((StringExp *) (*cases)[k]->exp)->charAt(pos) == c)
+	      group.push((*cases)[k]);
+	  }
+
+	add_stmt(build_case_label(build_integer_cst(c, etype), NULL_TREE,
+				  build_artificial_label()));
+	this->build_string_case_tree(&group, len, ptr, index, done);
+      }
+    tree body = pop_stmt_list();
+
+    add_stmt(build3(SWITCH_EXPR, etype, cond, body, NULL_TREE));
+    this->do_jump(NULL, done);
+  }
+
+  // Lower a switch on a string with a known set of cases to a decision
+  // tree, first on the length of the string and then on its characters,
+  // with one compare of the whole string at the end.  Returns the index
+  // of the matching case for the SWITCH_EXPR, or -1 if there is none,
+  // or NULL_TREE to leave it to the runtime library.
+  tree build_string_switch(SwitchStatement *s, tree condition)
+  {
+    if (s->hasVars || s->cases->dim > MAX_STRING_SWITCH_TREE || optimize_size)
+      return NULL_TREE;
+
+    for (size_t i = 0; i < s->cases->dim; i++)
+      {
+	if ((*s->cases)[i]->exp->op != TOKstring)
+	  return NULL_TREE;
+      }
+
+    tree var = build_local_temp(TREE_TYPE (condition));
+    add_stmt(build_vinit(var, condition));
+    tree len = d_array_length(var);
+    tree ptr = d_array_ptr(var);
+
+    tree index = build_local_temp(build_ctype(Type::tint32));
+    add_stmt(build_vinit(index, build_integer_cst(-1, TREE_TYPE (index))));
+    tree done = build_artificial_label();
+
+    for (size_t i = 0; i < s->cases->dim; i++)
+      (*s->cases)[i]->index = i;
+
+    push_stmt_list();
+    for (size_t i = 0; i < s->cases->dim; i++)
+      {
+	size_t length = ((StringExp *) (*s->cases)[i]->exp)->len;
+	size_t k = 0;
+	while (k < i && ((StringExp *) (*s->cases)[k]->exp)->len != length)
+	  k++;
+	if (k < i)
+	  continue;		// already handled with an earlier case
+
+	CaseStatements group;
+	for (k = i; k < s->cases->dim; k++)
+	  {
+	    if (((StringExp *) (*s->cases)[k]->exp)->len == length)
+	      group.push((*s->cases)[k]);
+	  }
+
+	add_stmt(build_case_label(build_integer_cst(length, TREE_TYPE (len)),
+				  NULL_TREE, build_artificial_label()));
+	this->build_string_case_tree(&group, length, ptr, index, done);
+      }
+    tree body = pop_stmt_list();
+
+    add_stmt(build3(SWITCH_EXPR, TREE_TYPE (len), len, body, NULL_TREE));
+    add_stmt(build1(LABEL_EXPR, void_type_node, done));
+
+    return index;
+  }
+
   void visit(SwitchStatement *s)
   {
     set_input_location(s->loc);
@@ -399,9 +558,16 @@ public:
     tree condition = s->condition->toElemDtor();
     Type *condtype = s->condition->type->toBasetype();
 
-    // A switch statement on a string gets turned into a library call,
-    // which does a binary lookup on list of string cases.
+    // A switch statement on a string gets turned into a decision tree or
+    // a library call, which does a binary lookup on list of string cases.
+    // Either gives the index of the case to switch on.
+    tree index = NULL_TREE;
     if (s->condition->type->isString())
+      index = this->build_string_switch(s, condition);
+
+    if (index != NULL_TREE)
+      condition = index;
+    else if (s->condition->type->isString())
       {
 	Type *etype = condtype->nextOf()->toBasetype();
 	LibCall libcall;